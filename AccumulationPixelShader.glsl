@@ -0,0 +1,12 @@
+#version 430
+
+// reading gl_SampleID runs this once per sample, so each sample of the destination gets the matching sample of the source
+layout(binding = 0) uniform sampler2DMSArray source_image;
+uniform float weight;
+flat in int source_layer;
+out vec4 output_color;
+
+void main()
+{
+	output_color = texelFetch(source_image, ivec3(ivec2(gl_FragCoord.xy), source_layer), gl_SampleID) * weight;
+}
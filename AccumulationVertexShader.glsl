@@ -0,0 +1,12 @@
+#version 430
+
+// the layer of the source image this instance reads
+flat out int source_layer;
+
+// a triangle covering the viewport, from gl_VertexID alone so no vertex buffer is needed
+void main()
+{
+	source_layer = gl_InstanceID;
+	vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+	gl_Position = vec4((corner * 2.0) - 1.0, 0.0, 1.0);
+}
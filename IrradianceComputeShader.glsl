@@ -0,0 +1,59 @@
+#version 430
+
+// must match IRRADIANCE_GROUP_SIZE in irradiance_volume.h
+layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+struct light_entry
+{
+	vec4 position;
+	vec4 color;
+};
+
+layout(std430, binding = 0) readonly buffer light_entry_table { light_entry light_entries[]; };
+layout(rgba16f, binding = 0) writeonly uniform image3D irradiance;
+
+uniform uint light_count;
+uniform vec3 volume_min;
+uniform vec3 voxel_size;
+uniform float illumination_distance;
+uniform float light_cutoff;
+
+// must match VertexShader.glsl
+float getAttenuationFromPosition(float illumination_dist, vec4 light_pos, vec4 vertex_pos, float cutoff)
+{
+	float attenuation;
+	vec4 L = light_pos - vertex_pos;
+	float distance = length(L);
+	float d = max(distance - illumination_dist, 0);
+	L /= distance;
+	float denom = d / (illumination_dist) + 1.0f;
+	attenuation = 1.0f / (denom * denom);
+	attenuation = (attenuation - cutoff) / (1.0f - cutoff);
+
+	return max(attenuation, 0);
+}
+
+// combineLights scales a light's color by its alpha, which the attenuation has already scaled, so each light contributes
+// its color times the attenuation squared and the brightest contribution per channel wins
+void main()
+{
+	ivec3 voxel = ivec3(gl_GlobalInvocationID);
+	if (any(greaterThanEqual(voxel, imageSize(irradiance))))
+		return;
+
+	vec4 voxel_center = vec4(volume_min + ((vec3(voxel) + 0.5f) * voxel_size), 1.0f);
+	vec4 total_light = vec4(0.0f);
+
+	for (uint i = 0; i < light_count; i++)
+	{
+		float attenuation = getAttenuationFromPosition(illumination_distance, light_entries[i].position, voxel_center, light_cutoff);
+
+		if (attenuation <= .001f)
+			continue;
+
+		vec4 light_color = light_entries[i].color * attenuation;
+		total_light = max(total_light, vec4(light_color.rgb * light_color.a, attenuation * attenuation));
+	}
+
+	imageStore(irradiance, voxel, total_light);
+}
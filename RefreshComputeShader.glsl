@@ -0,0 +1,55 @@
+#version 430
+
+// must match REFRESH_COMPUTE_GROUP_SIZE in gpu_refresh_generator.h
+layout(local_size_x = 256) in;
+
+struct refresh_step
+{
+	mat4 matrix;
+	vec4 color;
+	float size;
+};
+
+layout(std430, binding = 0) readonly buffer step_table { refresh_step steps[]; };
+layout(std430, binding = 1) readonly buffer sequence_front { uint matrix_sequence_front[]; };
+layout(std430, binding = 2) readonly buffer sequence_back { uint matrix_sequence_back[]; };
+layout(std430, binding = 3) writeonly buffer position_stream { vec4 positions[]; };
+layout(std430, binding = 4) writeonly buffer color_stream { vec4 colors[]; };
+layout(std430, binding = 5) writeonly buffer size_stream { float sizes[]; };
+
+uniform uint point_count;
+uniform uint first_point;
+uniform uint first_vertex;
+uniform uint sequence_size;
+uniform uint num_back;
+uniform int window_size;
+uniform vec4 origin;
+uniform vec4 base_color;
+uniform float base_size;
+
+// point i is the composite of the window of steps i through i + window_size - 1, applied to origin
+void main()
+{
+	uint point = first_point + gl_GlobalInvocationID.x;
+	if (point >= point_count)
+		return;
+
+	mat4 window_matrix = mat4(1.0f);
+	vec4 window_color = vec4(0.0f);
+	float window_point_size = 0.0f;
+
+	for (int n = 0; n < window_size; n++)
+	{
+		uint sequence_index = (point + uint(n)) % sequence_size;
+		uint step_index = (matrix_sequence_front[sequence_index] * num_back) + matrix_sequence_back[sequence_index];
+
+		window_matrix = steps[step_index].matrix * window_matrix;
+		window_color += steps[step_index].color;
+		window_point_size += steps[step_index].size;
+	}
+
+	uint vertex = first_vertex + point;
+	positions[vertex] = window_matrix * origin;
+	colors[vertex] = (base_color + window_color) / float(window_size + 1);
+	sizes[vertex] = (base_size + window_point_size) / float(window_size + 1);
+}
@@ -1,11 +1,47 @@
 #version 430
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
 
 #define LIGHT_COUNT 256
+#define LIGHT_GRID_SIZE 16
+#define DOF_VIEW_COUNT 50
 
 layout(location = 0) in vec4 position; 
 layout(location = 1) in vec4 color; 
 layout(location = 2) in float point_size; 
 layout(location = 3) in vec2 palette_position; 
+// the other keyframe bracketing the displayed state, only enabled while keyframes are blended
+layout(location = 4) in vec4 keyframe_position;
+layout(location = 5) in vec4 keyframe_color;
+layout(location = 6) in float keyframe_point_size;
+
+// indexed colors, bindings must match indexed_color_table.h
+struct indexed_entry
+{
+	vec4 color_front;
+	vec4 color_back;
+	float size_front;
+	float size_back;
+};
+
+layout(std430, binding = 6) readonly buffer indexed_entry_table { indexed_entry indexed_entries[]; };
+layout(std430, binding = 7) readonly buffer indexed_sequence_front { uint indexed_matrix_sequence_front[]; };
+layout(std430, binding = 8) readonly buffer indexed_sequence_back { uint indexed_matrix_sequence_back[]; };
+layout(std430, binding = 9) readonly buffer indexed_window_start_table { uint indexed_window_starts[]; };
+
+// dynamic lights binned by light_grid, bindings and grid size must match light_grid.h
+struct light_entry
+{
+	vec4 position;
+	vec4 color;
+};
+
+layout(std430, binding = 10) readonly buffer light_entry_table { light_entry light_entries[]; };
+layout(std430, binding = 11) readonly buffer light_cell_table { uint light_cells[]; };
+
+// depth of field views, binding and size must match fractal_generator.h
+layout(std140, binding = 0) uniform dof_view_block { mat4 dof_view_mvps[DOF_VIEW_COUNT]; };
+
 uniform mat4 MVP; 
 uniform mat4 model_matrix; 
 uniform mat4 view_matrix; 
@@ -33,10 +69,33 @@ uniform int override_point_color_enabled;
 uniform vec4 point_override_color;
 uniform int override_light_color_enabled;
 uniform vec4 light_override_color;
+// dynamic lights when light_grid is unavailable
 uniform vec4 light_positions[LIGHT_COUNT];
 uniform vec4 light_colors[LIGHT_COUNT];
+uniform int light_grid_enabled = 0;
+uniform vec3 light_grid_min;
+uniform vec3 light_grid_cell_size;
+// dynamic lights splatted by irradiance_volume, takes precedence over the grid, unit must match irradiance_volume.h
+layout(binding = 1) uniform sampler3D irradiance_volume;
+uniform int irradiance_volume_enabled = 0;
+uniform vec3 irradiance_volume_min;
+uniform vec3 irradiance_volume_size;
 uniform int max_point_size;
 uniform float point_size_modifier;
+uniform float keyframe_blend = 0.0f;
+// compact vertex buffers store positions as normalized offsets from the center of their upload's bounds
+uniform vec3 position_center = vec3(0.0f);
+uniform vec3 position_extent = vec3(1.0f);
+uniform vec3 keyframe_position_center = vec3(0.0f);
+uniform vec3 keyframe_position_extent = vec3(1.0f);
+uniform int indexed_colors = 0;
+uniform int indexed_window_size = 0;
+uniform int indexed_deduplicated = 0;
+uniform float indexed_interpolation_state = 0.0f;
+uniform float indexed_base_size = 0.1f;
+// while set, instance n is drawn from view dof_first_view + n into layer n of the bound framebuffer
+uniform int dof_instanced = 0;
+uniform int dof_first_view = 0;
 
 vec4 clampColor(vec4 color)
 {
@@ -107,6 +166,70 @@ vec4 combineLights(vec4 light_a, vec4 light_b)
 	return vec4(max(actual_a.r, actual_b.r), max(actual_a.g, actual_b.g), max(actual_a.b, actual_b.b), 1.0f);
 }
 
+vec4 addDynamicLight(vec4 total_light, vec4 light_position, vec4 light_color, vec4 scaled_position)
+{
+	float attenuation = getAttenuationFromPosition(illumination_distance, light_position, scaled_position, light_cutoff);
+
+	if (attenuation <= .001f)
+		return total_light;
+
+	return combineLights(total_light, (override_light_color_enabled == 1 ? light_override_color : light_color) * attenuation);
+}
+
+// lights combine by their maximum, so once every channel is saturated the rest cannot change the result
+bool lightSaturated(vec4 total_light)
+{
+	return total_light.r >= 1.0f && total_light.g >= 1.0f && total_light.b >= 1.0f;
+}
+
+vec4 getDynamicLight(vec4 scaled_position)
+{
+	vec4 total_light = vec4(0.0f);
+
+	// rgb is the combined light of every light's own color and a is what an override color would be scaled by
+	if (irradiance_volume_enabled == 1)
+	{
+		vec4 irradiance = texture(irradiance_volume, (scaled_position.xyz - irradiance_volume_min) / irradiance_volume_size);
+		return vec4(override_light_color_enabled == 1 ? light_override_color.rgb * light_override_color.a * irradiance.a : irradiance.rgb, 1.0f);
+	}
+
+	if (light_grid_enabled == 0)
+	{
+		for (int i = 0; i < LIGHT_COUNT; i++)
+		{
+			if (light_positions[i].w < .001f)
+				continue;
+
+			total_light = addDynamicLight(total_light, light_positions[i], light_colors[i], scaled_position);
+
+			if (lightSaturated(total_light))
+				break;
+		}
+
+		return total_light;
+	}
+
+	// positions outside the grid are beyond every light's reach
+	ivec3 cell = ivec3(floor((scaled_position.xyz - light_grid_min) / light_grid_cell_size));
+	if (any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, ivec3(LIGHT_GRID_SIZE))))
+		return total_light;
+
+	uint cell_index = uint(cell.x + (LIGHT_GRID_SIZE * (cell.y + (LIGHT_GRID_SIZE * cell.z))));
+	uint first_light = light_cells[cell_index * 2];
+	uint cell_light_count = light_cells[(cell_index * 2) + 1];
+
+	for (uint n = 0; n < cell_light_count; n++)
+	{
+		light_entry light = light_entries[light_cells[first_light + n]];
+		total_light = addDynamicLight(total_light, light.position, light.color, scaled_position);
+
+		if (lightSaturated(total_light))
+			break;
+	}
+
+	return total_light;
+}
+
 float getAttenuation(vec4 scaled_position)
 {
 	vec4 light_position;
@@ -133,9 +256,42 @@ float getAttenuation(vec4 scaled_position)
 	return clamp(global_attenuation, 0.0f, 1.0f);
 }
 
+vec4 decodePosition(vec4 stored_position, vec3 center, vec3 extent)
+{
+	return vec4(center + (extent * stored_position.xyz), stored_position.w);
+}
+
+// the sums fractal_engine::writeRefreshVertex divides, over this vertex's window of the matrix sequences
+void resolveIndexedColor(out vec4 resolved_color, out float resolved_size)
+{
+	uint start = indexed_deduplicated > 0 ? indexed_window_starts[gl_VertexID] : uint(gl_VertexID);
+	uint sequence_size = uint(indexed_matrix_sequence_front.length());
+
+	resolved_color = invert_colors > 0 ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+	resolved_size = indexed_base_size;
+
+	for (int n = 0; n < indexed_window_size; n++)
+	{
+		uint sequence_index = (start + uint(n)) % sequence_size;
+		indexed_entry front = indexed_entries[indexed_matrix_sequence_front[sequence_index]];
+		indexed_entry back = indexed_entries[indexed_matrix_sequence_back[sequence_index]];
+
+		resolved_color += mix(back.color_back, front.color_front, indexed_interpolation_state);
+		resolved_size += mix(back.size_back, front.size_front, indexed_interpolation_state);
+	}
+
+	resolved_color /= float(indexed_window_size + 1);
+	resolved_size /= float(indexed_window_size + 1);
+}
+
 void main()
 {
-	vec4 scaled_position = fractal_scale * position;
+	// with a blend of zero the keyframe attributes have no effect, so exact frames are drawn unchanged
+	vec4 vertex_position = mix(decodePosition(position, position_center, position_extent), decodePosition(keyframe_position, keyframe_position_center, keyframe_position_extent), keyframe_blend);
+	vec4 vertex_color = mix(color, keyframe_color, keyframe_blend);
+	float vertex_point_size = mix(point_size, keyframe_point_size, keyframe_blend);
+
+	vec4 scaled_position = fractal_scale * vertex_position;
 	if (render_palette > 0)
 	{
 		gl_Position = vec4(palette_position.x, palette_position.y, 0.0f, 1.0f);
@@ -148,7 +304,15 @@ void main()
 		return;
 	}
 
-	gl_Position = MVP * scaled_position;
+	gl_Position = (dof_instanced > 0 ? dof_view_mvps[dof_first_view + gl_InstanceID] : MVP) * scaled_position;
+
+#if defined(GL_ARB_shader_viewport_layer_array) || defined(GL_AMD_vertex_shader_layer)
+	gl_Layer = gl_InstanceID;
+#endif
+
+	// colors are linear in the interpolation state, so resolving them at the displayed state matches blended keyframes too
+	if (indexed_colors > 0)
+		resolveIndexedColor(vertex_color, vertex_point_size);
 
 	float alpha_value;
 	if (override_line_color_enabled == 1 && geometry_type == 1)
@@ -171,8 +335,8 @@ void main()
 
 	else
 	{
-		alpha_value = color.a;
-		fragment_color = vec4(color.rgb, alpha_value);
+		alpha_value = vertex_color.a;
+		fragment_color = vec4(vertex_color.rgb, alpha_value);
 	}
 
 	if (invert_colors > 0)
@@ -193,22 +357,7 @@ void main()
 		//dynamic lighting calcs
 		else
 		{
-			vec4 total_light = vec4(0.0f);
-			for (int i = 0; i < LIGHT_COUNT; i++)
-			{
-				if (light_positions[i].w < .001f)
-					continue;
-
-				float attenuation = getAttenuationFromPosition(illumination_distance, light_positions[i], scaled_position, light_cutoff);
-
-				if (attenuation <= .001f)
-					continue;
-
-				total_light = combineLights(total_light, (override_light_color_enabled == 1 ? light_override_color : light_colors[i]) * attenuation);
-
-				if (total_light.r >= 1.0f && total_light.g >= 1.0f && total_light.b >= 1.0f)
-					break;
-			}
+			vec4 total_light = getDynamicLight(scaled_position);
 
 			vec4 ambient_light = background_color;
 			ambient_light.a = 0.5f;
@@ -223,6 +372,6 @@ void main()
 		gl_Position = quadrant_matrix * gl_Position;
 	}
 
-	float distance = length(position - vec4(camera_position, 1.0f));
-	gl_PointSize = int(point_size * float(max_point_size) * point_size_modifier * clamp(1.0f / distance, 0.1f, float(max_point_size)));
+	float distance = length(vertex_position - vec4(camera_position, 1.0f));
+	gl_PointSize = int(vertex_point_size * float(max_point_size) * point_size_modifier * clamp(1.0f / distance, 0.1f, float(max_point_size)));
 }
\ No newline at end of file
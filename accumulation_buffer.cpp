@@ -0,0 +1,273 @@
+#include "accumulation_buffer.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static bool readShaderSource(const string &path, string &source)
+{
+	std::ifstream shader_file(path);
+	if (!shader_file.is_open())
+	{
+		cout << "unable to open " << path << ", depth of field passes will be drawn over each other" << endl;
+		return false;
+	}
+
+	std::stringstream shader_stream;
+	shader_stream << shader_file.rdbuf();
+	source = shader_stream.str();
+	return true;
+}
+
+static GLuint compileShader(GLenum type, const string &source)
+{
+	const char *source_text = source.c_str();
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source_text, nullptr);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled == GL_TRUE)
+		return shader;
+
+	GLint log_length = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+	vector<char> log(max(log_length, 1));
+	glGetShaderInfoLog(shader, log.size(), nullptr, &log[0]);
+	cout << "accumulation shader failed to compile: " << &log[0] << endl;
+
+	glDeleteShader(shader);
+	return 0;
+}
+
+static bool hasExtension(const char *name)
+{
+	GLint extension_count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+
+	for (GLint i = 0; i < extension_count; i++)
+	{
+		const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (extension != nullptr && strcmp(extension, name) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+accumulation_buffer::~accumulation_buffer()
+{
+	if (program == 0)
+		return;
+
+	deleteTargets();
+	glDeleteVertexArrays(1, &vertex_array);
+	glDeleteProgram(program);
+}
+
+bool accumulation_buffer::initialize(const string &vertex_shader_path, const string &pixel_shader_path)
+{
+	string vertex_source;
+	string pixel_source;
+	if (!readShaderSource(vertex_shader_path, vertex_source) || !readShaderSource(pixel_shader_path, pixel_source))
+		return false;
+
+	GLuint vertex_shader = compileShader(GL_VERTEX_SHADER, vertex_source);
+	GLuint pixel_shader = compileShader(GL_FRAGMENT_SHADER, pixel_source);
+
+	if (vertex_shader == 0 || pixel_shader == 0)
+	{
+		glDeleteShader(vertex_shader);
+		glDeleteShader(pixel_shader);
+		return false;
+	}
+
+	GLuint linked_program = glCreateProgram();
+	glAttachShader(linked_program, vertex_shader);
+	glAttachShader(linked_program, pixel_shader);
+	glLinkProgram(linked_program);
+	glDeleteShader(vertex_shader);
+	glDeleteShader(pixel_shader);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(linked_program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		GLint log_length = 0;
+		glGetProgramiv(linked_program, GL_INFO_LOG_LENGTH, &log_length);
+		vector<char> log(max(log_length, 1));
+		glGetProgramInfoLog(linked_program, log.size(), nullptr, &log[0]);
+		cout << "accumulation shader failed to link: " << &log[0] << endl;
+
+		glDeleteProgram(linked_program);
+		return false;
+	}
+
+	program = linked_program;
+	weight_location = glGetUniformLocation(program, "weight");
+
+	// core profiles draw nothing without a vertex array bound, even though the triangle has no attributes
+	glGenVertexArrays(1, &vertex_array);
+
+	// the same extensions VertexShader.glsl checks before writing gl_Layer
+	layered_passes = hasExtension("GL_ARB_shader_viewport_layer_array") || hasExtension("GL_AMD_vertex_shader_layer");
+	glGetIntegerv(GL_MAX_FRAMEBUFFER_LAYERS, &max_layers);
+	max_layers = max(max_layers, 1);
+
+	return true;
+}
+
+void accumulation_buffer::deleteTargets()
+{
+	glDeleteTextures(1, &scene_color);
+	glDeleteTextures(1, &scene_depth);
+	glDeleteTextures(1, &accumulation_color);
+	glDeleteFramebuffers(1, &scene_fbo);
+	glDeleteFramebuffers(1, &accumulation_fbo);
+
+	scene_color = 0;
+	scene_depth = 0;
+	accumulation_color = 0;
+	scene_fbo = 0;
+	accumulation_fbo = 0;
+	width = 0;
+	height = 0;
+	samples = 0;
+	layers = 0;
+}
+
+void accumulation_buffer::resizeTargets(GLsizei new_width, GLsizei new_height, GLsizei new_samples, GLsizei new_layers)
+{
+	deleteTargets();
+
+	width = new_width;
+	height = new_height;
+	samples = new_samples;
+	layers = new_layers;
+
+	// every target is an array so one shader reads them all, the scene target matches the 8 bit destinations so a pass
+	// blends exactly as it would if drawn there directly
+	glGenTextures(1, &scene_color);
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, scene_color);
+	glTexImage3DMultisample(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, samples, GL_RGBA8, width, height, layers, GL_TRUE);
+
+	// renderbuffers cannot be layered, so depth is a texture as well
+	glGenTextures(1, &scene_depth);
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, scene_depth);
+	glTexImage3DMultisample(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, samples, GL_DEPTH_COMPONENT24, width, height, layers, GL_TRUE);
+
+	// full floats keep the fractional part of each weighted pass, which 8 bits would round away, and still resolve to
+	// the same 8 bit color after a kept image has summed hundreds of unweighted passes
+	glGenTextures(1, &accumulation_color);
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, accumulation_color);
+	glTexImage3DMultisample(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, samples, GL_RGBA32F, width, height, 1, GL_TRUE);
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 0);
+
+	glGenFramebuffers(1, &scene_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, scene_fbo);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, scene_color, 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, scene_depth, 0);
+
+	glGenFramebuffers(1, &accumulation_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, accumulation_fbo);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, accumulation_color, 0, 0);
+}
+
+int accumulation_buffer::begin(int pass_count, bool keep_image)
+{
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &destination_fbo);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &destination_read_fbo);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	// a single sampled destination is matched by one sample targets, which the shader reads the same way
+	GLint destination_samples = 0;
+	glGetIntegerv(GL_SAMPLES, &destination_samples);
+	GLsizei target_samples = max(destination_samples, 1);
+	GLsizei target_width = viewport[0] + viewport[2];
+	GLsizei target_height = viewport[1] + viewport[3];
+
+	// an 8 bit color and a 24 bit depth sample per pixel and layer
+	long long layer_bytes = max(1ll, (long long)target_width * (long long)target_height * (long long)target_samples * 8ll);
+	GLsizei target_layers = 1;
+	if (layered_passes)
+		target_layers = GLsizei(glm::clamp<long long>(min<long long>(pass_count, MAX_SCENE_TARGET_BYTES / layer_bytes), 1, max_layers));
+
+	// a kept image also keeps any extra layers, since dropping them would reallocate and clear it
+	bool resized = target_width != width || target_height != height || target_samples != samples;
+	resized = resized || target_layers > layers || (target_layers < layers && !keep_image);
+	if (resized)
+		resizeTargets(target_width, target_height, target_samples, target_layers);
+
+	const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, accumulation_fbo);
+	if (resized || !keep_image)
+		glClearBufferfv(GL_COLOR, 0, zero);
+
+	return layers;
+}
+
+void accumulation_buffer::beginPass(const vec4 &background)
+{
+	const GLfloat clear_color[4] = { background.r, background.g, background.b, background.a };
+	const GLfloat far_depth = 1.0f;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, scene_fbo);
+	glClearBufferfv(GL_COLOR, 0, clear_color);
+	glClearBufferfv(GL_DEPTH, 0, &far_depth);
+}
+
+void accumulation_buffer::accumulate(float weight, int pass_count)
+{
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, accumulation_fbo);
+	drawImage(scene_color, weight, true, glm::clamp(pass_count, 1, int(layers)));
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, scene_fbo);
+}
+
+void accumulation_buffer::resolve(float weight)
+{
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination_fbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, destination_read_fbo);
+	drawImage(accumulation_color, weight, false, 1);
+}
+
+void accumulation_buffer::drawImage(GLuint source, float weight, bool additive, int layer_count) const
+{
+	GLint previous_program = 0;
+	GLint previous_vertex_array = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vertex_array);
+	GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	GLint blend_equation_rgb, blend_equation_alpha, blend_source_rgb, blend_destination_rgb, blend_source_alpha, blend_destination_alpha;
+	glGetIntegerv(GL_BLEND_EQUATION_RGB, &blend_equation_rgb);
+	glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &blend_equation_alpha);
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blend_source_rgb);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blend_destination_rgb);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend_source_alpha);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &blend_destination_alpha);
+
+	glUseProgram(program);
+	glUniform1f(weight_location, weight);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, source);
+
+	glDisable(GL_DEPTH_TEST);
+	if (additive)
+	{
+		glEnable(GL_BLEND);
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFunc(GL_ONE, GL_ONE);
+	}
+
+	else glDisable(GL_BLEND);
+
+	glBindVertexArray(vertex_array);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 3, layer_count);
+	glBindVertexArray(previous_vertex_array);
+
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 0);
+	glUseProgram(previous_program);
+	depth_test ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+	blend ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+	glBlendEquationSeparate(blend_equation_rgb, blend_equation_alpha);
+	glBlendFuncSeparate(blend_source_rgb, blend_destination_rgb, blend_source_alpha, blend_destination_alpha);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#ifndef ACCUMULATION_BUFFER_H
+#define ACCUMULATION_BUFFER_H
+
+#include "header.h"
+
+// most bytes the layered scene target may take, passes beyond what fits are drawn in further batches
+#define MAX_SCENE_TARGET_BYTES (256ll * 1024ll * 1024ll)
+
+// averages several renders of the scene on the gpu, in place of the fixed function accumulation buffer
+// each pass is drawn into a scene target with the destination's size and sample count, then added sample by sample into a
+// float accumulation target, and resolve writes the sum back into the destination. samples never leave the gpu and
+// multisampled destinations stay multisampled, so it works the same for the window and the offscreen image targets
+// when the vertex shader can write gl_Layer, the scene target has a layer per pass and one instanced draw renders several
+// passes at once, each instance into the layer matching its gl_InstanceID
+class accumulation_buffer
+{
+public:
+	accumulation_buffer() {};
+	~accumulation_buffer();
+
+	bool initialize(const string &vertex_shader_path, const string &pixel_shader_path);
+	bool isAvailable() const { return program != 0; }
+
+	// starts an image of pass_count passes for the framebuffer currently bound for drawing, at the current viewport
+	// returns how many of them can be drawn between each beginPass and accumulate, 1 without layered rendering
+	// with keep_image the passes are added to the last image instead, which is only cleared if the targets were reallocated
+	int begin(int pass_count, bool keep_image = false);
+
+	// binds the scene target with every layer cleared to background, draws until the next accumulate are one batch of passes
+	void beginPass(const vec4 &background);
+
+	// adds the batch's first pass_count layers to the image, each scaled by weight, and leaves the scene target bound
+	void accumulate(float weight, int pass_count = 1);
+
+	// writes the image scaled by weight over the destination given to begin and binds the destination again
+	void resolve(float weight = 1.0f);
+
+private:
+	accumulation_buffer(const accumulation_buffer &);
+	accumulation_buffer &operator=(const accumulation_buffer &);
+
+	GLuint program = 0;
+	GLuint vertex_array = 0;
+	GLint weight_location = -1;
+
+	// set when the vertex shader extensions for writing gl_Layer are present
+	bool layered_passes = false;
+	GLint max_layers = 1;
+
+	GLuint scene_fbo = 0;
+	GLuint scene_color = 0;
+	GLuint scene_depth = 0;
+	GLuint accumulation_fbo = 0;
+	GLuint accumulation_color = 0;
+
+	// current size of the targets, they are only reallocated when the destination changes
+	GLsizei width = 0;
+	GLsizei height = 0;
+	GLsizei samples = 0;
+	GLsizei layers = 0;
+
+	// bindings to restore at resolve, resizing the targets rebinds both
+	GLint destination_fbo = 0;
+	GLint destination_read_fbo = 0;
+	GLint viewport[4];
+
+	void resizeTargets(GLsizei new_width, GLsizei new_height, GLsizei new_samples, GLsizei new_layers);
+	void deleteTargets();
+
+	// a fullscreen triangle per layer, reading the first layer_count layers of source sample by sample into the bound framebuffer
+	void drawImage(GLuint source, float weight, bool additive, int layer_count) const;
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "affine_kernels.h"
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AFFINE_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// gcc and clang only emit vector instructions for functions that ask for them, msvc emits whatever intrinsics are used
+#if defined(AFFINE_KERNELS_X86) && defined(__GNUC__)
+#define KERNEL_TARGET_SSE __attribute__((target("sse2")))
+#define KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define KERNEL_TARGET_SSE
+#define KERNEL_TARGET_AVX2
+#endif
+
+affine_matrix toAffineMatrix(const mat4 &matrix)
+{
+	affine_matrix affine;
+
+	// glm is column major, matrix[column][row]
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			affine.rows[(row * 4) + column] = matrix[column][row];
+		}
+	}
+
+	return affine;
+}
+
+static void transformPointsIndexedScalar(const affine_matrix *matrices, const int *matrix_indices, float *x, float *y, float *z, long long count)
+{
+	for (long long i = 0; i < count; i++)
+	{
+		const float *m = matrices[matrix_indices[i]].rows;
+		float px = x[i];
+		float py = y[i];
+		float pz = z[i];
+
+		x[i] = (m[0] * px) + (m[1] * py) + (m[2] * pz) + m[3];
+		y[i] = (m[4] * px) + (m[5] * py) + (m[6] * pz) + m[7];
+		z[i] = (m[8] * px) + (m[9] * py) + (m[10] * pz) + m[11];
+	}
+}
+
+#ifdef AFFINE_KERNELS_X86
+
+KERNEL_TARGET_SSE static void transformPointsIndexedSSE(const affine_matrix *matrices, const int *matrix_indices, float *x, float *y, float *z, long long count)
+{
+	long long i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const float *m0 = matrices[matrix_indices[i]].rows;
+		const float *m1 = matrices[matrix_indices[i + 1]].rows;
+		const float *m2 = matrices[matrix_indices[i + 2]].rows;
+		const float *m3 = matrices[matrix_indices[i + 3]].rows;
+
+		// sse has no gather, each matrix element is assembled across the four lanes
+		__m128 rows[12];
+		for (int k = 0; k < 12; k++)
+		{
+			rows[k] = _mm_setr_ps(m0[k], m1[k], m2[k], m3[k]);
+		}
+
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+
+		_mm_storeu_ps(x + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[0], px), _mm_mul_ps(rows[1], py)), _mm_mul_ps(rows[2], pz)), rows[3]));
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[4], px), _mm_mul_ps(rows[5], py)), _mm_mul_ps(rows[6], pz)), rows[7]));
+		_mm_storeu_ps(z + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[8], px), _mm_mul_ps(rows[9], py)), _mm_mul_ps(rows[10], pz)), rows[11]));
+	}
+
+	transformPointsIndexedScalar(matrices, matrix_indices + i, x + i, y + i, z + i, count - i);
+}
+
+KERNEL_TARGET_AVX2 static void transformPointsIndexedAVX2(const affine_matrix *matrices, const int *matrix_indices, float *x, float *y, float *z, long long count)
+{
+	const float *base = matrices[0].rows;
+	const __m256i matrix_stride = _mm256_set1_epi32(12);
+	long long i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i offsets = _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(matrix_indices + i)), matrix_stride);
+
+		__m256 rows[12];
+		for (int k = 0; k < 12; k++)
+		{
+			rows[k] = _mm256_i32gather_ps(base + k, offsets, 4);
+		}
+
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		__m256 pz = _mm256_loadu_ps(z + i);
+
+		_mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rows[0], px), _mm256_mul_ps(rows[1], py)), _mm256_mul_ps(rows[2], pz)), rows[3]));
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rows[4], px), _mm256_mul_ps(rows[5], py)), _mm256_mul_ps(rows[6], pz)), rows[7]));
+		_mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rows[8], px), _mm256_mul_ps(rows[9], py)), _mm256_mul_ps(rows[10], pz)), rows[11]));
+	}
+
+	transformPointsIndexedScalar(matrices, matrix_indices + i, x + i, y + i, z + i, count - i);
+}
+
+static bool cpuSupportsAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// the os must also save ymm registers on context switches
+	__cpuid(info, 1);
+	bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+	__cpuidex(info, 7, 0);
+	return os_saves_ymm && (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static kernel_instruction_set detectInstructionSet()
+{
+	return cpuSupportsAVX2() ? KERNEL_AVX2 : KERNEL_SSE;
+}
+
+#else
+
+static kernel_instruction_set detectInstructionSet()
+{
+	return KERNEL_SCALAR;
+}
+
+#endif
+
+static std::atomic<int> &selectedInstructionSet()
+{
+	static std::atomic<int> selected(detectInstructionSet());
+	return selected;
+}
+
+void transformPointsIndexed(const affine_matrix *matrices, const int *matrix_indices, float *x, float *y, float *z, long long count)
+{
+	if (count <= 0)
+		return;
+
+	switch (kernel_instruction_set(selectedInstructionSet().load()))
+	{
+#ifdef AFFINE_KERNELS_X86
+	case KERNEL_AVX2: transformPointsIndexedAVX2(matrices, matrix_indices, x, y, z, count); break;
+	case KERNEL_SSE: transformPointsIndexedSSE(matrices, matrix_indices, x, y, z, count); break;
+#endif
+	default: transformPointsIndexedScalar(matrices, matrix_indices, x, y, z, count); break;
+	}
+}
+
+kernel_instruction_set getKernelInstructionSet()
+{
+	return kernel_instruction_set(selectedInstructionSet().load());
+}
+
+kernel_instruction_set setKernelInstructionSet(kernel_instruction_set requested)
+{
+	kernel_instruction_set selected = kernel_instruction_set(min(int(requested), int(detectInstructionSet())));
+	selectedInstructionSet().store(selected);
+	return selected;
+}
+
+string getStringFromKernelInstructionSet(kernel_instruction_set instruction_set)
+{
+	switch (instruction_set)
+	{
+	case KERNEL_SCALAR: return "scalar";
+	case KERNEL_SSE: return "sse";
+	case KERNEL_AVX2: return "avx2";
+	default: return "unknown";
+	}
+}
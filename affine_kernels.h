@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef AFFINE_KERNELS_H
+#define AFFINE_KERNELS_H
+
+#include "engine_header.h"
+
+// top three rows of an affine mat4, row major. every matrix the engine generates has a bottom row of (0, 0, 0, 1)
+struct affine_matrix
+{
+	float rows[12];
+};
+
+enum kernel_instruction_set { KERNEL_SCALAR, KERNEL_SSE, KERNEL_AVX2 };
+
+affine_matrix toAffineMatrix(const mat4 &matrix);
+
+// transforms point i of the structure-of-arrays coordinates by matrices[matrix_indices[i]] in place
+// processes 8 points per instruction with avx2, 4 with sse, one at a time otherwise
+void transformPointsIndexed(const affine_matrix *matrices, const int *matrix_indices, float *x, float *y, float *z, long long count);
+
+// widest instruction set supported by the cpu is selected on first use
+kernel_instruction_set getKernelInstructionSet();
+
+// requests are clamped to what the cpu supports, returns the instruction set actually selected
+kernel_instruction_set setKernelInstructionSet(kernel_instruction_set requested);
+
+string getStringFromKernelInstructionSet(kernel_instruction_set instruction_set);
+
+#endif
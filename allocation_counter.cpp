@@ -0,0 +1,40 @@
+#include "allocation_counter.h"
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<long long> heap_allocation_count(0);
+
+// the array, nothrow, and delete forms all forward to these two
+void *operator new(size_t byte_count)
+{
+	heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+	void *allocated = std::malloc(byte_count > 0 ? byte_count : 1);
+	if (allocated == nullptr)
+		throw std::bad_alloc();
+
+	return allocated;
+}
+
+void operator delete(void *allocated) noexcept
+{
+	std::free(allocated);
+}
+
+long long getHeapAllocationCount()
+{
+	return heap_allocation_count.load(std::memory_order_relaxed);
+}
+
+#else
+
+long long getHeapAllocationCount()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+// debug builds replace the global operator new with one that counts, so generation can be checked for heap allocations
+#if defined(_DEBUG) && !defined(COUNT_HEAP_ALLOCATIONS)
+#define COUNT_HEAP_ALLOCATIONS
+#endif
+
+// operator new calls made by every thread of the process so far, always zero unless COUNT_HEAP_ALLOCATIONS is defined
+long long getHeapAllocationCount();
+
+#endif
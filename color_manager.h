@@ -1,6 +1,6 @@
 #pragma once
 
-#include "header.h"
+#include "engine_header.h"
 #include "random_generator.h"
 
 //RANDOM_PALETTE must be first, DEFAULT_COLOR_PALETTE must be last
@@ -85,6 +85,7 @@ public:
 	void printColorSet(const vector<vec4> &set) const;
 
 	void seed(const string seed) { mc.seed(seed); }
+	void copyStateFrom(const color_manager &other) { mc.copyStateFrom(other.mc); }
 
 private:
 	random_generator mc;
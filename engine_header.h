@@ -0,0 +1,100 @@
+#pragma once
+
+// GL-free base header shared by the fractal engine and the viewer
+// nothing included here may depend on OpenGL, GLFW, jep libraries or Windows.h
+
+#define THETA 1.61803398875f
+#define PI 3.14159f
+#define LIGHT_COUNT 128
+#define POINT_SCALE_MIN 0.01f
+#define POINT_SCALE_MAX 0.1f
+
+// most points a fractal may have. vertex indices and window starts are 32 bit, and the gpu refresh generator addresses points
+// in all three vertex buffer ring regions with 32 bit offsets, so three times this must still fit in a uint
+#define MAX_POINT_COUNT 1073741824LL
+
+// primitive modes mirror the GL enumerations so stored settings can be passed straight to draw calls
+#define PRIMITIVE_LINES 0x0001
+#define PRIMITIVE_LINE_STRIP 0x0003
+#define PRIMITIVE_TRIANGLES 0x0004
+#define PRIMITIVE_TRIANGLE_STRIP 0x0005
+#define PRIMITIVE_TRIANGLE_FAN 0x0006
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <chrono>
+#include <iostream>
+#include <climits>
+#include <cfloat>
+#include <cmath>
+#include <time.h>
+#include <boost/smart_ptr/shared_ptr.hpp>
+#include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+#include <gtx/string_cast.hpp>
+#include <gtx/intersect.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/functional/hash.hpp>
+#include <typeinfo>
+#include <limits>
+#include <memory>
+
+enum lighting_mode { UNIFORM_LIGHTING, CAMERA, ORIGIN, CENTERPOINT, DYNAMIC_LIGHTING, LIGHTING_MODE_SIZE };
+
+using std::string;
+using std::vector;
+using std::map;
+using std::pair;
+using std::cout;
+using std::endl;
+using std::min;
+using std::max;
+
+using boost::shared_ptr;
+
+using glm::mat4;
+using glm::vec2;
+using glm::vec3;
+using glm::vec4;
+
+typedef std::pair<bool, float> random_switch;
+
+class random_generator;
+class fractal_engine;
+
+template<class T>
+void cycleEnum(T first, T last, T &current)
+{
+	if (current == last)
+	{
+		current = first;
+	}
+
+	else current = T(int(current) + 1);
+}
+
+static string getStringFromLightingMode(lighting_mode lm)
+{
+	switch (lm)
+	{
+	case UNIFORM_LIGHTING: return "uniform";
+	case ORIGIN: return "origin";
+	case CENTERPOINT: return "centerpoint";
+	case CAMERA: return "camera";
+	case DYNAMIC_LIGHTING: return "dynamic";
+	default: return "unknown";
+	}
+}
+
+template<class T>
+T influenceElement(const T &target, const T &influence, float degree)
+{
+	return (target * (1.0f - degree)) + (influence * degree);
+}
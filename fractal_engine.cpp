@@ -0,0 +1,1932 @@
+#include "fractal_engine.h"
+#include "allocation_counter.h"
+#include <unordered_map>
+#include <limits>
+
+// window i covers steps i through i + window_size - 1. window starts are split into blocks of window_size, and each window
+// is the composite of a suffix of its own block and a prefix of the next, so every point costs three compositions
+// regardless of window_size
+template <typename window_handler>
+void fractal_engine::aggregateRefreshWindows(long long begin, long long end, int window_size, const vector<refresh_step> &steps, window_handler handle_window) const
+{
+	const generation_slot &front = frontSlot();
+	const generation_slot &back = backSlot();
+	int num_back = back.matrices.size();
+	int sequence_size = front.matrix_sequence.size();
+	frame_vector<refresh_step> suffixes(window_size, refresh_step(), arena);
+	frame_vector<refresh_step> prefixes(window_size, refresh_step(), arena);
+
+	auto getStep = [&](long long step_index) -> const refresh_step & {
+		long long sequence_index = step_index % sequence_size;
+		return steps[front.matrix_sequence[sequence_index] * num_back + back.matrix_sequence[sequence_index]];
+	};
+
+	// later steps are applied on the left, color and size are plain sums
+	auto combine = [](const refresh_step &earlier, const refresh_step &later, refresh_step &combined) {
+		combined.matrix = later.matrix * earlier.matrix;
+		combined.color = earlier.color + later.color;
+		combined.size = earlier.size + later.size;
+	};
+
+	for (long long block_start = begin; block_start < end; block_start += window_size)
+	{
+		int block_windows = (int)min((long long)window_size, end - block_start);
+
+		suffixes[window_size - 1] = getStep(block_start + window_size - 1);
+		for (int k = window_size - 2; k >= 0; k--)
+		{
+			combine(getStep(block_start + k), suffixes[k + 1], suffixes[k]);
+		}
+
+		handle_window(block_start, suffixes[0]);
+
+		if (block_windows > 1)
+			prefixes[0] = getStep(block_start + window_size);
+
+		for (int k = 1; k < block_windows; k++)
+		{
+			if (k > 1)
+				combine(prefixes[k - 2], getStep(block_start + window_size + k - 1), prefixes[k - 1]);
+
+			refresh_step window;
+			combine(suffixes[k], prefixes[k - 1], window);
+			handle_window(block_start + k, window);
+		}
+	}
+}
+
+
+
+fractal_engine::fractal_engine(const string &randomization_seed, long long num_points)
+{
+	vertex_count = min(num_points, MAX_POINT_COUNT);
+	base_seed = randomization_seed;
+
+	rg.seed(base_seed);
+	color_man.seed(base_seed);
+	sm.randomize(rg);
+	generateLights();
+	setMatrices();
+}
+
+fractal_engine::~fractal_engine()
+{
+	cancelSlotPrefetch();
+}
+
+vector< pair<string, mat4> > fractal_engine::generateMatrixVector(const int &count, geometry_type &geo_type, const slot_parameters &parameters, random_generator &generator) const
+{
+	vector< pair<string, mat4> > matrix_vector;
+
+	if (generator.getRandomFloat() < parameters.matrix_geometry_coefficient)
+	{
+		vector<vec4> point_sequence;
+		int matrix_geometry_index;
+		// TODO create mc exception class
+		/*if (loaded_sequences.size() > 0)
+			sm.matrix_geometry_weights[LOADED_SEQUENCE] = mc.getRandomIntInRange(0, loaded_sequences.size() * 10);*/
+
+		if (!generator.catRoll<int>(parameters.matrix_geometry_weights, matrix_geometry_index))
+			throw;
+
+		float random_width = generator.getRandomFloatInRange(0.2f, 1.0f);
+		float random_height = generator.getRandomFloatInRange(0.2f, 1.0f);
+		float random_depth = generator.getRandomFloatInRange(0.2f, 1.0f);
+
+		if (matrix_geometry_index < GEOMETRY_TYPE_SIZE)
+		{
+			geometry_type gt = geometry_type(matrix_geometry_index);
+
+			float random_width = generator.getRandomFloatInRange(0.2f, 1.0f);
+			float random_height = generator.getRandomFloatInRange(0.2f, 1.0f);
+			float random_depth = generator.getRandomFloatInRange(0.2f, 1.0f);
+
+			switch (gt)
+			{
+			case CUBOID: point_sequence = gm.getCuboidVertices(random_width, random_height, random_depth); break;
+			case CUBE: point_sequence = gm.getCubeVertices(random_width); break;
+			case TETRAHEDRON: point_sequence = gm.getTetrahedronVertices(random_width); break;
+			case OCTAHEDRON: point_sequence = gm.getOctahedronVertices(random_width); break;
+			case DODECAHEDRON: point_sequence = gm.getDodecahedronVertices(random_width); break;
+			case ICOSAHEDRON: point_sequence = gm.getIcosahedronVertices(random_width); break;
+				//case LOADED_SEQUENCE: geo_type = DEFAULT_GEOMETRY_TYPE;
+			case GEOMETRY_TYPE_SIZE:
+			default: throw;
+			}
+		}
+
+		else
+		{
+			matrix_geometry_index -= (int)GEOMETRY_TYPE_SIZE;
+			ngon_type nt = ngon_type(matrix_geometry_index);
+			int side_count = (int)nt + 3;
+			point_sequence = gm.getNgonVertices(generator.getRandomFloatInRange(0.2f, 1.0f), side_count);
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			vec3 vertex(point_sequence.at(i % point_sequence.size()));
+			matrix_vector.push_back(std::pair<string, mat4>("translate (" + std::to_string(matrix_geometry_index) + ")", glm::translate(mat4(1.0f), vertex)));
+		}
+	}
+
+	else
+	{
+		geo_type = GEOMETRY_TYPE_SIZE;
+		int matrix_type;
+
+		for (int i = 0; i < count; i++)
+		{
+			short matrix_type;
+			std::map<short, unsigned int> matrix_map;
+			matrix_map[0] = parameters.translate_weight;
+			matrix_map[1] = parameters.rotate_weight;
+			matrix_map[2] = parameters.scale_matrices ? parameters.scale_weight : 0;
+
+			// TODO create mc exception class
+			if (!generator.catRoll<short>(matrix_map, matrix_type))
+				throw;
+
+			string matrix_category;
+			mat4 matrix_to_add;
+
+			switch (matrix_type)
+			{
+			case 0:
+				matrix_to_add = parameters.two_dimensional ? generator.getRandomTranslation2D() : generator.getRandomTranslation();
+				matrix_category = "translate";
+				break;
+			case 1:
+				matrix_to_add = parameters.two_dimensional ? generator.getRandomRotation2D() : generator.getRandomRotation();
+				matrix_category = "rotate";
+				break;
+			case 2:
+				matrix_to_add = parameters.two_dimensional ? generator.getRandomScale2D() : generator.getRandomScale();
+				matrix_category = "scale";
+				break;
+			default: break;
+			}
+
+			matrix_vector.push_back(pair<string, mat4>(matrix_category, matrix_to_add));
+		}
+	}
+
+	return matrix_vector;
+}
+
+vector<vec4> fractal_engine::generateColorVector(const vec4 &seed, const int &count, color_palette &random_selection,
+	const slot_parameters &parameters, random_generator &generator, const color_manager &colors) const
+{
+	vector<vec4> color_set;
+
+	color_set = colors.generatePaletteFromSeed(seed, parameters.palette, count, random_selection);
+
+	if (parameters.randomize_alpha)
+		colors.randomizeAlpha(color_set, parameters.alpha_min, parameters.alpha_max);
+
+	if (parameters.randomize_lightness)
+		colors.modifyLightness(color_set, generator.getRandomFloatInRange(0.3, 1.2f));
+
+	return color_set;
+}
+
+vector<float> fractal_engine::generateSizeVector(const int &count, random_generator &generator) const
+{
+	vector<float> size_vector;
+
+	for (int i = 0; i < count; i++)
+	{
+		size_vector.push_back(generator.getRandomFloatInRange(POINT_SCALE_MIN, POINT_SCALE_MAX));
+	}
+
+	return size_vector;
+}
+
+fractal_engine::slot_parameters fractal_engine::getSlotParameters(int generation, bool front, int count) const
+{
+	slot_parameters parameters;
+	parameters.generation = generation;
+	parameters.front = front;
+	parameters.count = count;
+	parameters.palette = front ? sm.palette_front : sm.palette_back;
+	parameters.random_palette = front ? sm.random_palette_front : sm.random_palette_back;
+	parameters.alpha_min = sm.alpha_min;
+	parameters.alpha_max = sm.alpha_max;
+	parameters.randomize_alpha = sm.randomize_alpha;
+	parameters.randomize_lightness = sm.randomize_lightness;
+	parameters.matrix_geometry_coefficient = sm.matrix_geometry_coefficient;
+	parameters.matrix_geometry_weights = sm.matrix_geometry_weights;
+	parameters.translate_weight = sm.translate_weight;
+	parameters.rotate_weight = sm.rotate_weight;
+	parameters.scale_weight = sm.scale_weight;
+	parameters.scale_matrices = sm.scale_matrices;
+	parameters.two_dimensional = sm.two_dimensional;
+
+	return parameters;
+}
+
+bool fractal_engine::slot_parameters::operator==(const slot_parameters &other) const
+{
+	return generation == other.generation && front == other.front && count == other.count
+		&& palette == other.palette && random_palette == other.random_palette
+		&& alpha_min == other.alpha_min && alpha_max == other.alpha_max
+		&& randomize_alpha == other.randomize_alpha && randomize_lightness == other.randomize_lightness
+		&& matrix_geometry_coefficient == other.matrix_geometry_coefficient && matrix_geometry_weights == other.matrix_geometry_weights
+		&& translate_weight == other.translate_weight && rotate_weight == other.rotate_weight && scale_weight == other.scale_weight
+		&& scale_matrices == other.scale_matrices && two_dimensional == other.two_dimensional;
+}
+
+void fractal_engine::generateSlot(const slot_parameters &parameters, random_generator &generator, const color_manager &colors,
+	generation_slot &slot, int &background_index, color_palette &random_palette) const
+{
+	background_index = generator.getRandomIntInRange(0, parameters.count);
+
+	slot.seed_color = generator.getRandomVec4FromColorRanges(
+		0.0f, 1.0f,		// red range
+		0.0f, 1.0f,		// green range
+		0.0f, 1.0f,		// blue range
+		parameters.alpha_min, parameters.alpha_max		// alpha range
+		);
+
+	random_palette = parameters.random_palette;
+	slot.matrices = generateMatrixVector(parameters.count, slot.geo_type, parameters, generator);
+	slot.colors = generateColorVector(slot.seed_color, parameters.count, random_palette, parameters, generator, colors);
+	slot.sizes = generateSizeVector(parameters.count, generator);
+}
+
+// this method is run once and only once per fractal gen object
+
+void fractal_engine::setMatrices()
+{
+	cancelSlotPrefetch();
+
+	generation_seed = base_seed + "_" + std::to_string(sm.generation);
+	rg.seed(generation_seed);
+	color_man.seed(generation_seed);
+
+	for (long long i = 0; i < vertex_count; i++)
+	{
+		frontSlot().matrix_sequence.push_back(int(rg.getRandomFloatInRange(0.0f, float(sm.num_matrices))));
+		backSlot().matrix_sequence.push_back(int(rg.getRandomFloatInRange(0.0f, float(sm.num_matrices))));
+	}
+
+	matrix_sequence_version++;
+	polynomials.valid = false;
+	polynomials.refused = false;
+
+	int random_palette_index = int(rg.getRandomFloatInRange(0.0f, float(DEFAULT_COLOR_PALETTE)));
+	sm.palette_front = color_palette(random_palette_index);
+	sm.palette_back = color_palette(random_palette_index);
+
+	//TODO add .reserve() for each vector
+	frontSlot().matrices.clear();
+	frontSlot().colors.clear();
+	frontSlot().sizes.clear();
+
+	backSlot().matrices.clear();
+	backSlot().colors.clear();
+	backSlot().sizes.clear();
+
+	//front data set
+	slot_parameters front_parameters = getSlotParameters(sm.generation, true, sm.num_matrices);
+	frontSlot().matrices = generateMatrixVector(sm.num_matrices, frontSlot().geo_type, front_parameters, rg);
+	frontSlot().seed_color = rg.getRandomVec4FromColorRanges(
+		0.0f, 1.0f,		// red range
+		0.0f, 1.0f,		// green range
+		0.0f, 1.0f,		// blue range
+		sm.alpha_min, sm.alpha_max		// alpha range
+		);
+	frontSlot().colors = generateColorVector(frontSlot().seed_color, sm.num_matrices, sm.random_palette_front, front_parameters, rg, color_man);
+	frontSlot().sizes = generateSizeVector(sm.num_matrices, rg);
+	
+	//back data set
+	sm.generation++;
+	generation_seed = base_seed + "_" + std::to_string(sm.generation);
+	rg.seed(generation_seed);
+	color_man.seed(generation_seed);
+	slot_parameters back_parameters = getSlotParameters(sm.generation, false, sm.num_matrices);
+	backSlot().matrices = generateMatrixVector(sm.num_matrices, backSlot().geo_type, back_parameters, rg);
+	//std::random_shuffle(frontSlot().matrices.begin(), frontSlot().matrices.end());
+	backSlot().seed_color = rg.getRandomVec4FromColorRanges(
+		0.0f, 1.0f,		// red range
+		0.0f, 1.0f,		// green range
+		0.0f, 1.0f,		// blue range
+		sm.alpha_min, sm.alpha_max		// alpha range
+		);
+	backSlot().colors = generateColorVector(backSlot().seed_color, sm.num_matrices, sm.random_palette_back, back_parameters, rg, color_man);
+	backSlot().sizes = generateSizeVector(sm.num_matrices, rg);
+}
+
+void fractal_engine::swapMatrices()
+{
+	if (sm.reverse)
+		sm.generation--;
+
+	else sm.generation++;
+
+	generation_seed = base_seed + "_" + std::to_string(sm.generation);
+
+	// forward, the old front becomes the back and the incoming front takes over the old back's matrix sequence, in reverse
+	// the mirror image. either way the slots trade places and only the incoming slot's matrices, colors and sizes are redrawn
+	front_slot_index = 1 - front_slot_index;
+
+	bool incoming_front = !sm.reverse;
+	generation_slot &incoming = incoming_front ? frontSlot() : backSlot();
+	const generation_slot &outgoing = incoming_front ? backSlot() : frontSlot();
+	slot_parameters parameters = getSlotParameters(sm.generation, incoming_front, outgoing.matrices.size());
+
+	int background_index;
+	color_palette random_palette;
+
+	if (!takeSlotPrefetch(parameters, incoming, background_index, random_palette))
+	{
+		rg.seed(generation_seed);
+		generateSlot(parameters, rg, color_man, incoming, background_index, random_palette);
+	}
+
+	if (incoming_front)
+	{
+		sm.background_back_index = sm.background_front_index;
+		sm.background_front_index = background_index;
+		sm.random_palette_front = random_palette;
+	}
+
+	else
+	{
+		sm.background_front_index = sm.background_back_index;
+		sm.background_back_index = background_index;
+		sm.random_palette_back = random_palette;
+	}
+
+	matrix_sequence_version++;
+	polynomials.valid = false;
+	polynomials.refused = false;
+
+	startSlotPrefetch();
+
+	if (sm.print_context_on_swap)
+		printContext();
+}
+
+void fractal_engine::startSlotPrefetch()
+{
+	cancelSlotPrefetch();
+
+	if (!sm.prefetch_generations)
+		return;
+
+	// assumes the next swap continues in the current direction, a reversal in between just generates inline
+	bool incoming_front = !sm.reverse;
+	int next_generation = sm.reverse ? sm.generation - 1 : sm.generation + 1;
+	const generation_slot &outgoing = incoming_front ? frontSlot() : backSlot();
+
+	prefetch.parameters = getSlotParameters(next_generation, incoming_front, outgoing.matrices.size());
+	prefetch.generator.seed(base_seed + "_" + std::to_string(next_generation));
+	// color_man is not drawn from again before the next swap unless newColors cancels this
+	prefetch.colors.copyStateFrom(color_man);
+
+	prefetch_pending = true;
+	prefetch_thread = std::thread([this]() {
+		generateSlot(prefetch.parameters, prefetch.generator, prefetch.colors, prefetch.slot, prefetch.background_index, prefetch.random_palette);
+	});
+}
+
+bool fractal_engine::takeSlotPrefetch(const slot_parameters &parameters, generation_slot &incoming, int &background_index, color_palette &random_palette)
+{
+	if (!prefetch_pending)
+		return false;
+
+	prefetch_thread.join();
+	prefetch_pending = false;
+
+	if (!(prefetch.parameters == parameters))
+		return false;
+
+	incoming.matrices.swap(prefetch.slot.matrices);
+	incoming.colors.swap(prefetch.slot.colors);
+	incoming.sizes.swap(prefetch.slot.sizes);
+	incoming.seed_color = prefetch.slot.seed_color;
+	incoming.geo_type = prefetch.slot.geo_type;
+	background_index = prefetch.background_index;
+	random_palette = prefetch.random_palette;
+
+	rg.copyStateFrom(prefetch.generator);
+	color_man.copyStateFrom(prefetch.colors);
+
+	return true;
+}
+
+void fractal_engine::cancelSlotPrefetch()
+{
+	if (!prefetch_pending)
+		return;
+
+	prefetch_thread.join();
+	prefetch_pending = false;
+}
+
+void fractal_engine::cycleColorPalette()
+{
+	// palettes separated in case these change independently at some point
+	if (sm.palette_front == DEFAULT_COLOR_PALETTE)
+		sm.palette_front = color_palette(0);
+
+	else sm.palette_front = color_palette(int(sm.palette_front) + 1);
+
+	if (sm.palette_back == DEFAULT_COLOR_PALETTE)
+		sm.palette_back = color_palette(0);
+
+	else sm.palette_back = color_palette(int(sm.palette_back) + 1);
+}
+
+void fractal_engine::printMatrices() const
+{
+	cout << "-----frontSlot().matrices-----" << endl;
+	for (const auto &matrix_pair : frontSlot().matrices)
+	{
+		cout << matrix_pair.first << endl;
+		cout << glm::to_string(matrix_pair.second) << endl;
+		cout << "----------" << endl;
+	}
+
+	cout << "-----backSlot().matrices-----" << endl;
+	for (const auto &matrix_pair : backSlot().matrices)
+	{
+		cout << matrix_pair.first << endl;
+		cout << glm::to_string(matrix_pair.second) << endl;
+		cout << "----------" << endl;
+	}
+
+	cout << "------------------" << endl;
+}
+
+void fractal_engine::generateFractalFromPointSequence()
+{
+	generated_frame &output = beginOutput();
+	vector<unsigned int> &line_indices_to_buffer = output.line_indices;
+	vector<unsigned int> &triangle_indices_to_buffer = output.triangle_indices;
+
+	int num_matrices = frontSlot().matrices.size();
+	long long sequence_count = vertex_count / (long long)sm.point_sequence.size();
+
+	vertex_streams &points = output.vertex_data;
+	points.resize(sequence_count * sm.point_sequence.size());
+	line_indices_to_buffer.reserve(sequence_count * sm.line_indices.size());
+	triangle_indices_to_buffer.reserve(sequence_count * sm.triangle_indices.size());
+
+	vec4 point_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+	float starting_size = POINT_SCALE_MAX;
+
+	mat4 origin_matrix = glm::scale(mat4(1.0f), vec3(1.0f, 1.0f, 1.0f));
+
+	long long current_sequence_index_lines = 0;
+	long long current_sequence_index_triangles = 0;
+
+	frame_vector<affine_matrix> instance_matrices(sequence_count, affine_matrix(), arena);
+	frame_vector<vec4> instance_colors(sequence_count, vec4(0.0f), arena);
+	frame_vector<float> instance_sizes(sequence_count, 0.0f, arena);
+
+	for (long long i = 0; i < sequence_count; i++)
+	{
+		int matrix_index_front = sm.smooth_render ? frontSlot().matrix_sequence.at(i) : int(rg.getRandomFloatInRange(0.0f, float(frontSlot().matrices.size())));
+		int matrix_index_back = sm.smooth_render ? backSlot().matrix_sequence.at(i) : int(rg.getRandomFloatInRange(0.0f, float(frontSlot().matrices.size())));
+
+		iteratePointSequence(origin_matrix, point_color, starting_size, matrix_index_front, matrix_index_back, line_indices_to_buffer, triangle_indices_to_buffer, current_sequence_index_lines, current_sequence_index_triangles);
+
+		instance_matrices[i] = toAffineMatrix(origin_matrix);
+		instance_colors[i] = point_color;
+		instance_sizes[i] = starting_size;
+	}
+
+	addPointSequenceInstances(instance_matrices, instance_colors, instance_sizes, points);
+
+	commitOutput();
+}
+
+void fractal_engine::generateFractal()
+{
+	generated_frame &output = beginOutput();
+
+	int num_matrices = frontSlot().matrices.size();
+	long long point_count = num_matrices > 0 ? vertex_count : 0;
+	vertex_streams &points = output.vertex_data;
+	points.resize(point_count);
+
+	// indices are drawn in the same order the serial chain consumed them, so unsmoothed renders stay consistent per seed
+	frame_vector<int> matrix_indices_front(point_count, 0, arena);
+	frame_vector<int> matrix_indices_back(point_count, 0, arena);
+
+	for (long long i = 0; i < point_count; i++)
+	{
+		matrix_indices_front[i] = sm.smooth_render ? frontSlot().matrix_sequence.at(i) : int(rg.getRandomFloatInRange(0.0f, float(frontSlot().matrices.size())));
+		matrix_indices_back[i] = sm.smooth_render ? backSlot().matrix_sequence.at(i) : int(rg.getRandomFloatInRange(0.0f, float(frontSlot().matrices.size())));
+	}
+
+	vec4 starting_point = origin;
+	vec4 point_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+	float starting_size = POINT_SCALE_MAX;
+
+	int block_count = sm.parallel_generation ? (int)min((long long)workers.getThreadCount(), point_count / PARALLEL_CHAIN_BLOCK_MIN) : 1;
+
+	if (block_count <= 1)
+	{
+		for (long long i = 0; i < point_count; i++)
+		{
+			addNewPointAndIterate(starting_point, point_color, starting_size, matrix_indices_front[i], matrix_indices_back[i], points, i);
+		}
+	}
+
+	else
+	{
+		// each step is p' = ((1 - t) * M_back + t * M_front) * p, with color and size following affine recurrences of the same shape,
+		// so the chain is a prefix scan over per-step operators. blocks compose their operators in parallel, block starting states
+		// are resolved serially from those composites, then every block replays the exact per-step chain from its own start
+		long long block_size = (point_count + block_count - 1) / block_count;
+		frame_vector<chain_transform> block_transforms(block_count, chain_transform(), arena);
+
+		workers.parallelFor(block_count, [&](long long begin, long long end) {
+			for (long long block = begin; block < end; block++)
+			{
+				long long block_end = min((block + 1) * block_size, point_count);
+				block_transforms[block] = composeChainTransform(block * block_size, block_end, matrix_indices_front, matrix_indices_back);
+			}
+		}, 1);
+
+		frame_vector<vec4> block_points(block_count, vec4(0.0f), arena);
+		frame_vector<vec4> block_colors(block_count, vec4(0.0f), arena);
+		frame_vector<float> block_sizes(block_count, 0.0f, arena);
+
+		for (int block = 0; block < block_count; block++)
+		{
+			block_points[block] = starting_point;
+			block_colors[block] = point_color;
+			block_sizes[block] = starting_size;
+
+			const chain_transform &transform = block_transforms[block];
+			starting_point = transform.point_matrix * starting_point;
+			point_color = (point_color * transform.scale) + transform.color_offset;
+			starting_size = (starting_size * transform.scale) + transform.size_offset;
+		}
+
+		workers.parallelFor(block_count, [&](long long begin, long long end) {
+			for (long long block = begin; block < end; block++)
+			{
+				long long block_end = min((block + 1) * block_size, point_count);
+
+				for (long long i = block * block_size; i < block_end; i++)
+				{
+					addNewPointAndIterate(block_points[block], block_colors[block], block_sizes[block], matrix_indices_front[i], matrix_indices_back[i], points, i);
+				}
+			}
+		}, 1);
+	}
+
+	addSequentialIndices(points.size(), output.line_indices, output.triangle_indices);
+
+	commitOutput();
+}
+
+fractal_engine::chain_transform fractal_engine::composeChainTransform(long long begin, long long end, const frame_vector<int> &matrix_indices_front, const frame_vector<int> &matrix_indices_back) const
+{
+	chain_transform composite;
+	composite.point_matrix = mat4(1.0f);
+	composite.scale = 1.0f;
+	composite.color_offset = vec4(0.0f);
+	composite.size_offset = 0.0f;
+
+	// color and size are pulled toward each step's blended target by bias_coefficient, so every step scales them by the same amount
+	float step_scale = 1.0f - sm.bias_coefficient;
+
+	for (long long i = begin; i < end; i++)
+	{
+		int matrix_index_front = matrix_indices_front[i];
+		int matrix_index_back = matrix_indices_back[i];
+
+		mat4 step_matrix = influenceElement<mat4>(backSlot().matrices.at(matrix_index_back).second, frontSlot().matrices.at(matrix_index_front).second, sm.interpolation_state);
+		vec4 step_color = influenceElement<vec4>(backSlot().colors.at(matrix_index_back), frontSlot().colors.at(matrix_index_front), sm.interpolation_state) * sm.bias_coefficient;
+		float step_size = influenceElement<float>(backSlot().sizes.at(matrix_index_back), frontSlot().sizes.at(matrix_index_front), sm.interpolation_state) * sm.bias_coefficient;
+
+		composite.point_matrix = step_matrix * composite.point_matrix;
+		composite.scale *= step_scale;
+		composite.color_offset = (composite.color_offset * step_scale) + step_color;
+		composite.size_offset = (composite.size_offset * step_scale) + step_size;
+	}
+
+	return composite;
+}
+
+void fractal_engine::generateFractalWithRefresh()
+{
+	generated_frame &output = beginOutput();
+	vector<unsigned int> &line_indices_to_buffer = output.line_indices;
+	vector<unsigned int> &triangle_indices_to_buffer = output.triangle_indices;
+
+	int num_matrices = frontSlot().matrices.size();
+	signed int actual_refresh = sm.refresh_value == -1 ? int(rg.getRandomFloatInRange(sm.refresh_min, sm.refresh_max)) : sm.refresh_value;
+
+	sm.interpolation_state = glm::clamp(sm.interpolation_state, 0.0f, 1.0f);
+
+	long long point_count = num_matrices > 0 ? vertex_count : 0;
+	vertex_streams &points = output.vertex_data;
+
+	// with smooth rendering each point depends only on its own window of the matrix sequences, so ranges of points can be built independently
+	// and neighboring windows share all but one step. without it, matrix indices are drawn from rg and must be generated in order
+	vector<unsigned int> &vertex_indices = output.point_vertex_indices;
+	vector<unsigned int> &multiplicity = output.vertex_multiplicity;
+
+	// a random refresh_value draws a new window size every frame, which would rebuild the polynomials every frame
+	bool use_polynomials = sm.smooth_render && actual_refresh > 0 && point_count > 0 && sm.polynomial_refresh_animation && sm.refresh_value != -1;
+	bool indexed_colors = canIndexRefreshColors();
+
+	if (use_polynomials && updateRefreshPolynomials(point_count, actual_refresh))
+	{
+		if (!indexed_colors && (!polynomials.colors_valid || polynomials.inverted != sm.inverted))
+			updateRefreshPolynomialColors();
+
+		points.resize(polynomials.vertex_count, indexed_colors);
+		evaluateRefreshPolynomials(sm.interpolation_state, points);
+
+		if (polynomials.vertex_indices.empty())
+			addSequentialIndices(points.size(), line_indices_to_buffer, triangle_indices_to_buffer);
+
+		else
+		{
+			vertex_indices = polynomials.vertex_indices;
+			multiplicity = polynomials.multiplicity;
+			line_indices_to_buffer = vertex_indices;
+			triangle_indices_to_buffer = vertex_indices;
+		}
+	}
+
+	else if (sm.smooth_render && actual_refresh > 0 && sm.deduplicate_refresh_points && findDistinctRefreshWindows(point_count, actual_refresh))
+	{
+		// few distinct windows, build each one once and index every point to its window's vertex
+		const vector<refresh_step> &steps = interpolated_steps;
+		buildInterpolatedSteps(interpolated_steps);
+
+		const vector<long long> &window_starts = refresh_windows.window_starts;
+		long long distinct_count = window_starts.size();
+		points.resize(distinct_count, indexed_colors);
+
+		workers.parallelFor(distinct_count, [&](long long begin, long long end) {
+			for (long long i = begin; i < end; i++)
+			{
+				writeRefreshVertex(composeRefreshWindow(window_starts[i], actual_refresh, steps), actual_refresh, points, i);
+			}
+		}, 64);
+
+		multiplicity = refresh_windows.multiplicity;
+		vertex_indices = refresh_windows.window_ids;
+
+		line_indices_to_buffer = vertex_indices;
+		triangle_indices_to_buffer = vertex_indices;
+	}
+
+	else if (sm.smooth_render && actual_refresh > 0)
+	{
+		const vector<refresh_step> &steps = interpolated_steps;
+		buildInterpolatedSteps(interpolated_steps);
+		points.resize(point_count, indexed_colors);
+
+		workers.parallelFor(point_count, [&](long long begin, long long end) {
+			aggregateRefreshWindows(begin, end, actual_refresh, steps, [&](long long i, const refresh_step &window) {
+				writeRefreshVertex(window, actual_refresh, points, i);
+			});
+		});
+
+		addSequentialIndices(points.size(), line_indices_to_buffer, triangle_indices_to_buffer);
+	}
+
+	else
+	{
+		points.resize(point_count);
+		generateRefreshPoints(point_count, actual_refresh, points);
+
+		addSequentialIndices(points.size(), line_indices_to_buffer, triangle_indices_to_buffer);
+	}
+
+	commitOutput();
+}
+
+void fractal_engine::composeRefreshVertex(const refresh_step &window, int actual_refresh, vec4 &position, vec4 &color, float &size) const
+{
+	position = window.matrix * origin;
+	color = ((sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f)) + window.color) / ((float)actual_refresh + 1.0f);
+	size = (POINT_SCALE_MAX + window.size) / ((float)actual_refresh + 1.0f);
+}
+
+void fractal_engine::writeRefreshVertex(const refresh_step &window, int actual_refresh, vertex_streams &points, long long index) const
+{
+	vec4 new_point, point_color;
+	float new_size;
+	composeRefreshVertex(window, actual_refresh, new_point, point_color, new_size);
+
+	points.setVertex(index, new_point, point_color, new_size);
+}
+
+void fractal_engine::generateRefreshPoints(long long point_count, int actual_refresh, vertex_streams &points)
+{
+	int num_back = backSlot().matrices.size();
+	int step_count = max(actual_refresh, 0);
+
+	const vector<refresh_step> &steps = interpolated_steps;
+	buildInterpolatedSteps(interpolated_steps);
+
+	frame_vector<affine_matrix> step_matrices(steps.size(), affine_matrix(), arena);
+	for (size_t i = 0; i < steps.size(); i++)
+	{
+		step_matrices[i] = toAffineMatrix(steps[i].matrix);
+	}
+
+	// points are finished a block at a time, so the index table and coordinates stay a fixed size however many points there are
+	long long block_size = min(point_count, (long long)REFRESH_POINT_BLOCK);
+	frame_vector<int> step_indices(block_size * step_count, 0, arena);
+	frame_vector<float> x(block_size, 0.0f, arena);
+	frame_vector<float> y(block_size, 0.0f, arena);
+	frame_vector<float> z(block_size, 0.0f, arena);
+	vec4 initial_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+
+	for (long long block_begin = 0; block_begin < point_count; block_begin += block_size)
+	{
+		long long block_count = min(block_size, point_count - block_begin);
+
+		// indices are drawn point by point in the order the per-point loop consumed rg, but stored step by step
+		// so every kernel pass reads a contiguous run of indices
+		for (long long i = 0; i < block_count; i++)
+		{
+			long long point = block_begin + i;
+
+			for (int n = 0; n < step_count; n++)
+			{
+				int matrix_index_front = sm.smooth_render ? frontSlot().matrix_sequence.at((point + n) % frontSlot().matrix_sequence.size()) : int(rg.getRandomFloatInRange(0.0f, float(frontSlot().matrices.size())));
+				int matrix_index_back = sm.smooth_render ? backSlot().matrix_sequence.at((point + n) % backSlot().matrix_sequence.size()) : int(rg.getRandomFloatInRange(0.0f, float(backSlot().matrices.size())));
+				step_indices[(n * block_count) + i] = (matrix_index_front * num_back) + matrix_index_back;
+			}
+		}
+
+		std::fill(x.begin(), x.begin() + block_count, origin.x);
+		std::fill(y.begin(), y.begin() + block_count, origin.y);
+		std::fill(z.begin(), z.begin() + block_count, origin.z);
+
+		workers.parallelFor(block_count, [&](long long begin, long long end) {
+			for (int n = 0; n < step_count; n++)
+			{
+				transformPointsIndexed(step_matrices.data(), &step_indices[(n * block_count) + begin], &x[begin], &y[begin], &z[begin], end - begin);
+			}
+
+			for (long long i = begin; i < end; i++)
+			{
+				vec4 point_color = initial_color;
+				float new_size = POINT_SCALE_MAX;
+
+				for (int n = 0; n < step_count; n++)
+				{
+					const refresh_step &step = steps[step_indices[(n * block_count) + i]];
+					point_color += step.color;
+					new_size += step.size;
+				}
+
+				point_color /= ((float)actual_refresh + 1.0f);
+				new_size /= ((float)actual_refresh + 1.0f);
+
+				points.setVertex(block_begin + i, vec4(x[i], y[i], z[i], 1.0f), point_color, new_size);
+			}
+		});
+	}
+}
+
+void fractal_engine::generateFractalFromPointSequenceWithRefresh()
+{
+	generated_frame &output = beginOutput();
+	vector<unsigned int> &line_indices_to_buffer = output.line_indices;
+	vector<unsigned int> &triangle_indices_to_buffer = output.triangle_indices;
+
+	int num_matrices = frontSlot().matrices.size();
+
+	signed int actual_refresh = sm.refresh_value == -1 ? int(rg.getRandomFloatInRange(sm.refresh_min, sm.refresh_max)) : sm.refresh_value;
+
+	long long sequence_count = num_matrices > 0 ? vertex_count / (long long)sm.point_sequence.size() : 0;
+	frame_vector<refresh_step> windows(sequence_count, refresh_step(), arena);
+
+	vertex_streams &points = output.vertex_data;
+	points.resize(sequence_count * sm.point_sequence.size());
+	line_indices_to_buffer.reserve(sequence_count * sm.line_indices.size());
+	triangle_indices_to_buffer.reserve(sequence_count * sm.triangle_indices.size());
+
+	if (sm.smooth_render && actual_refresh > 0 && sm.deduplicate_refresh_points && findDistinctRefreshWindows(sequence_count, actual_refresh))
+	{
+		const vector<refresh_step> &steps = interpolated_steps;
+		buildInterpolatedSteps(interpolated_steps);
+
+		const vector<unsigned int> &window_ids = refresh_windows.window_ids;
+		const vector<long long> &window_starts = refresh_windows.window_starts;
+		frame_vector<refresh_step> distinct_windows(window_starts.size(), refresh_step(), arena);
+
+		for (size_t i = 0; i < window_starts.size(); i++)
+		{
+			distinct_windows[i] = composeRefreshWindow(window_starts[i], actual_refresh, steps);
+		}
+
+		for (long long i = 0; i < sequence_count; i++)
+		{
+			windows[i] = distinct_windows[window_ids[i]];
+		}
+	}
+
+	else if (sm.smooth_render && actual_refresh > 0)
+	{
+		const vector<refresh_step> &steps = interpolated_steps;
+		buildInterpolatedSteps(interpolated_steps);
+
+		workers.parallelFor(sequence_count, [&](long long begin, long long end) {
+			aggregateRefreshWindows(begin, end, actual_refresh, steps, [&windows](long long i, const refresh_step &window) {
+				windows[i] = window;
+			});
+		}, 64);
+	}
+
+	else
+	{
+		for (long long i = 0; i < sequence_count; i++)
+		{
+			refresh_step &window = windows[i];
+			window.matrix = glm::scale(mat4(1.0f), vec3(1.0f, 1.0f, 1.0f));
+			window.color = vec4(0.0f);
+			window.size = 0.0f;
+
+			for (int n = 0; n < actual_refresh; n++)
+			{
+				int matrix_index_front = sm.smooth_render ? frontSlot().matrix_sequence.at((i + n) % frontSlot().matrix_sequence.size()) : int(rg.getRandomFloatInRange(0.0f, float(frontSlot().matrices.size())));
+				int matrix_index_back = sm.smooth_render ? backSlot().matrix_sequence.at((i + n) % backSlot().matrix_sequence.size()) : int(rg.getRandomFloatInRange(0.0f, float(backSlot().matrices.size())));
+
+				mat4 matrix_front = frontSlot().matrices.at(matrix_index_front).second;
+				mat4 matrix_back = backSlot().matrices.at(matrix_index_back).second;
+				mat4 interpolated_matrix = influenceElement<mat4>(matrix_back, matrix_front, sm.interpolation_state);
+				vec4 transformation_color = influenceElement<vec4>(backSlot().colors.at(matrix_index_back), frontSlot().colors.at(matrix_index_front), sm.interpolation_state);
+				float transformation_size = influenceElement<float>(backSlot().sizes.at(matrix_index_back), frontSlot().sizes.at(matrix_index_front), sm.interpolation_state);
+
+				window.matrix = interpolated_matrix * window.matrix;
+				window.color += transformation_color;
+				window.size += transformation_size;
+			}
+		}
+	}
+
+	frame_vector<affine_matrix> instance_matrices(sequence_count, affine_matrix(), arena);
+	frame_vector<vec4> instance_colors(sequence_count, vec4(0.0f), arena);
+	frame_vector<float> instance_sizes(sequence_count, 0.0f, arena);
+
+	for (long long i = 0; i < sequence_count; i++)
+	{
+		instance_matrices[i] = toAffineMatrix(windows[i].matrix);
+		instance_colors[i] = ((sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f)) + windows[i].color) / float(actual_refresh + 1);
+		instance_sizes[i] = (POINT_SCALE_MAX + windows[i].size) / float(actual_refresh + 1);
+
+		long long index_sequences_added = i;
+
+		// determine where values should begin based on the used sequence and number of indices already added
+
+		vector<int>::iterator max_local_value_lines = std::max_element(sm.line_indices.begin(), sm.line_indices.end());
+		long long starting_index_lines = index_sequences_added * (*max_local_value_lines + 1);
+		for (const int index : sm.line_indices)
+		{
+			line_indices_to_buffer.push_back(starting_index_lines + index);
+		}
+
+		vector<int>::iterator max_local_value_triangles = std::max_element(sm.triangle_indices.begin(), sm.triangle_indices.end());
+		long long starting_index_triangles = index_sequences_added * (*max_local_value_triangles + 1);
+		for (const int index : sm.triangle_indices)
+		{
+			triangle_indices_to_buffer.push_back(starting_index_triangles + index);
+		}
+	}
+
+	addPointSequenceInstances(instance_matrices, instance_colors, instance_sizes, points);
+
+	commitOutput();
+}
+
+bool fractal_engine::findDistinctRefreshWindows(long long count, int window_size)
+{
+	refresh_window_table &table = refresh_windows;
+
+	if (table.searched && table.sequence_version == matrix_sequence_version && table.window_size == window_size && table.count == count)
+		return table.distinct;
+
+	table.searched = true;
+	table.sequence_version = matrix_sequence_version;
+	table.window_size = window_size;
+	table.count = count;
+	table.distinct = false;
+	vector<unsigned int>().swap(table.window_ids);
+	vector<long long>().swap(table.window_starts);
+	vector<unsigned int>().swap(table.multiplicity);
+
+	int sequence_size = frontSlot().matrix_sequence.size();
+	const generation_slot &front = frontSlot();
+	const generation_slot &back = backSlot();
+	unsigned long long step_count = front.matrices.size() * back.matrices.size();
+
+	if (count <= 0 || sequence_size == 0 || step_count == 0)
+		return false;
+
+	// a window's key is its step ids read as a base step_count number, which is exact as long as it fits in 64 bits
+	unsigned long long leading_place = 1;
+	for (int n = 1; n < window_size; n++)
+	{
+		if (leading_place > ULLONG_MAX / step_count / step_count)
+			return false;
+
+		leading_place *= step_count;
+	}
+
+	// windows start at min(count, sequence_size) different sequence positions. drawn from at least twice as many keys, about 79%
+	// of those are expected to differ, which is over half of count once they are more than 3/4 of it, so the search would fail
+	unsigned long long key_space = leading_place * step_count;
+	long long start_positions = min(count, (long long)sequence_size);
+	if (key_space / 2 >= (unsigned long long)start_positions && start_positions * 4 > count * 3)
+		return false;
+
+	auto getStepId = [&](long long step_index) -> unsigned long long {
+		long long sequence_index = step_index % sequence_size;
+		return front.matrix_sequence[sequence_index] * back.matrices.size() + back.matrix_sequence[sequence_index];
+	};
+
+	unsigned long long key = 0;
+	for (int n = 0; n < window_size; n++)
+	{
+		key = (key * step_count) + getStepId(n);
+	}
+
+	// only worth it when most windows repeat, ids are vertex indices so they must also fit the 32 bit index buffers
+	long long distinct_limit = min(count / 2, (long long)UINT_MAX);
+	typedef std::unordered_map<unsigned long long, unsigned int, std::hash<unsigned long long>, std::equal_to<unsigned long long>,
+		arena_allocator<std::pair<const unsigned long long, unsigned int> > > window_map;
+	window_map distinct_windows(0, std::hash<unsigned long long>(), std::equal_to<unsigned long long>(), arena);
+	table.window_ids.resize(count);
+
+	for (long long i = 0; i < count; i++)
+	{
+		if (i > 0)
+			key = ((key - (getStepId(i - 1) * leading_place)) * step_count) + getStepId(i + window_size - 1);
+
+		window_map::iterator found = distinct_windows.find(key);
+
+		if (found == distinct_windows.end())
+		{
+			if ((long long)table.window_starts.size() == distinct_limit)
+			{
+				vector<unsigned int>().swap(table.window_ids);
+				vector<long long>().swap(table.window_starts);
+				return false;
+			}
+
+			found = distinct_windows.insert(std::make_pair(key, (unsigned int)table.window_starts.size())).first;
+			table.window_starts.push_back(i);
+		}
+
+		table.window_ids[i] = found->second;
+	}
+
+	table.multiplicity.assign(table.window_starts.size(), 0);
+	for (long long i = 0; i < count; i++)
+	{
+		table.multiplicity[table.window_ids[i]]++;
+	}
+
+	table.distinct = true;
+	return true;
+}
+
+fractal_engine::refresh_step fractal_engine::composeRefreshWindow(long long start, int window_size, const vector<refresh_step> &steps) const
+{
+	const generation_slot &front = frontSlot();
+	const generation_slot &back = backSlot();
+	int num_back = back.matrices.size();
+	int sequence_size = front.matrix_sequence.size();
+
+	refresh_step window;
+	window.matrix = mat4(1.0f);
+	window.color = vec4(0.0f);
+	window.size = 0.0f;
+
+	for (int n = 0; n < window_size; n++)
+	{
+		long long sequence_index = (start + n) % sequence_size;
+		const refresh_step &step = steps[front.matrix_sequence[sequence_index] * num_back + back.matrix_sequence[sequence_index]];
+		window.matrix = step.matrix * window.matrix;
+		window.color += step.color;
+		window.size += step.size;
+	}
+
+	return window;
+}
+
+template <typename start_vector>
+void fractal_engine::findVertexWindowStarts(const vector<unsigned int> &vertex_indices, long long distinct_count, start_vector &window_starts) const
+{
+	// the largest value of the element type marks a window not yet seen, no point index reaches it
+	typedef typename start_vector::value_type start_type;
+	const start_type unseen = std::numeric_limits<start_type>::max();
+	window_starts.assign(distinct_count, unseen);
+
+	for (long long i = 0; i < (long long)vertex_indices.size(); i++)
+	{
+		if (window_starts[vertex_indices[i]] == unseen)
+			window_starts[vertex_indices[i]] = start_type(i);
+	}
+}
+
+void fractal_engine::getVertexWindowStarts(vector<unsigned int> &window_starts) const
+{
+	window_starts.clear();
+	if (point_vertex_indices.empty())
+		return;
+
+	findVertexWindowStarts(point_vertex_indices, vertex_data.size(), window_starts);
+}
+
+vec4 fractal_engine::getIndexedColor(long long point_index) const
+{
+	int sequence_size = frontSlot().matrix_sequence.size();
+	vec4 color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+
+	for (int n = 0; n < sm.refresh_value; n++)
+	{
+		long long sequence_index = (point_index + n) % sequence_size;
+		color += influenceElement<vec4>(backSlot().colors.at(backSlot().matrix_sequence[sequence_index]), frontSlot().colors.at(frontSlot().matrix_sequence[sequence_index]), sm.interpolation_state);
+	}
+
+	return color / ((float)sm.refresh_value + 1.0f);
+}
+
+void fractal_engine::buildInterpolatedSteps(vector<refresh_step> &steps) const
+{
+	int num_front = frontSlot().matrices.size();
+	int num_back = backSlot().matrices.size();
+	steps.resize(num_front * num_back);
+
+	for (int front = 0; front < num_front; front++)
+	{
+		for (int back = 0; back < num_back; back++)
+		{
+			refresh_step &step = steps[front * num_back + back];
+			step.matrix = influenceElement<mat4>(backSlot().matrices.at(back).second, frontSlot().matrices.at(front).second, sm.interpolation_state);
+			step.color = influenceElement<vec4>(backSlot().colors.at(back), frontSlot().colors.at(front), sm.interpolation_state);
+			step.size = influenceElement<float>(backSlot().sizes.at(back), frontSlot().sizes.at(front), sm.interpolation_state);
+		}
+	}
+}
+
+bool fractal_engine::updateRefreshPolynomials(long long point_count, int window_size)
+{
+	if ((polynomials.valid || polynomials.refused) && polynomials.degree == window_size && polynomials.point_count == point_count
+		&& polynomials.deduplicate == sm.deduplicate_refresh_points)
+		return polynomials.valid;
+
+	polynomials.valid = false;
+	polynomials.refused = false;
+	polynomials.degree = window_size;
+	polynomials.point_count = point_count;
+	polynomials.deduplicate = sm.deduplicate_refresh_points;
+
+	bool deduplicated = sm.deduplicate_refresh_points && findDistinctRefreshWindows(point_count, window_size);
+	const vector<long long> &window_starts = refresh_windows.window_starts;
+	long long count = deduplicated ? (long long)window_starts.size() : point_count;
+
+	// only the vertices that are actually built count against the cap
+	if (count * (long long)(window_size + 1) * 3 > MAX_REFRESH_POLYNOMIAL_FLOATS)
+	{
+		polynomials.refused = true;
+		return false;
+	}
+
+	polynomials.vertex_indices.clear();
+	polynomials.multiplicity.clear();
+
+	if (deduplicated)
+	{
+		polynomials.vertex_indices = refresh_windows.window_ids;
+		polynomials.multiplicity = refresh_windows.multiplicity;
+	}
+
+	polynomials.vertex_count = count;
+	long long block_floats = (long long)(window_size + 1) * 3 * REFRESH_POLYNOMIAL_BLOCK;
+	long long block_count = (count + REFRESH_POLYNOMIAL_BLOCK - 1) / REFRESH_POLYNOMIAL_BLOCK;
+	polynomials.position_coefficients.resize(block_count * block_floats);
+
+	const generation_slot &front_slot = frontSlot();
+	const generation_slot &back_slot = backSlot();
+	int sequence_size = front_slot.matrix_sequence.size();
+
+	workers.parallelFor(count, [&](long long begin, long long end) {
+		frame_vector<vec4> coefficients(window_size + 1, vec4(0.0f), arena);
+
+		for (long long i = begin; i < end; i++)
+		{
+			long long start = deduplicated ? window_starts[i] : i;
+			coefficients[0] = origin;
+
+			for (int n = 0; n < window_size; n++)
+			{
+				long long sequence_index = (start + n) % sequence_size;
+				int front = front_slot.matrix_sequence[sequence_index];
+				int back = back_slot.matrix_sequence[sequence_index];
+				const mat4 &matrix_back = back_slot.matrices[back].second;
+				const mat4 &matrix_front = front_slot.matrices[front].second;
+
+				// multiplying by (1 - t) * back + t * front raises the degree by one, back feeds each power of (1 - t) and front each power of t
+				coefficients[n + 1] = matrix_front * coefficients[n];
+				for (int k = n; k > 0; k--)
+				{
+					coefficients[k] = (matrix_back * coefficients[k]) + (matrix_front * coefficients[k - 1]);
+				}
+				coefficients[0] = matrix_back * coefficients[0];
+			}
+
+			for (int k = 0; k <= window_size; k++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					long long block_offset = ((i / REFRESH_POLYNOMIAL_BLOCK) * block_floats) + (i % REFRESH_POLYNOMIAL_BLOCK);
+					polynomials.position_coefficients[block_offset + (((k * 3) + axis) * REFRESH_POLYNOMIAL_BLOCK)] = coefficients[k][axis];
+				}
+			}
+		}
+	}, 64);
+
+	polynomials.valid = true;
+	polynomials.colors_valid = false;
+
+	return true;
+}
+
+void fractal_engine::updateRefreshPolynomialColors()
+{
+	long long count = polynomials.vertex_count;
+	int window_size = polynomials.degree;
+
+	frame_vector<long long> window_starts(arena);
+	if (!polynomials.vertex_indices.empty())
+		findVertexWindowStarts(polynomials.vertex_indices, count, window_starts);
+
+	polynomials.colors_at_zero.resize(count);
+	polynomials.colors_at_one.resize(count);
+	polynomials.sizes_at_zero.resize(count);
+	polynomials.sizes_at_one.resize(count);
+
+	const generation_slot &front_slot = frontSlot();
+	const generation_slot &back_slot = backSlot();
+	int sequence_size = front_slot.matrix_sequence.size();
+	vec4 base_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+
+	workers.parallelFor(count, [&](long long begin, long long end) {
+		for (long long i = begin; i < end; i++)
+		{
+			long long start = window_starts.empty() ? i : window_starts[i];
+			vec4 color_at_zero = base_color;
+			vec4 color_at_one = base_color;
+			float size_at_zero = POINT_SCALE_MAX;
+			float size_at_one = POINT_SCALE_MAX;
+
+			for (int n = 0; n < window_size; n++)
+			{
+				long long sequence_index = (start + n) % sequence_size;
+				int front = front_slot.matrix_sequence[sequence_index];
+				int back = back_slot.matrix_sequence[sequence_index];
+
+				color_at_zero += back_slot.colors[back];
+				color_at_one += front_slot.colors[front];
+				size_at_zero += back_slot.sizes[back];
+				size_at_one += front_slot.sizes[front];
+			}
+
+			polynomials.colors_at_zero[i] = color_at_zero / ((float)window_size + 1.0f);
+			polynomials.colors_at_one[i] = color_at_one / ((float)window_size + 1.0f);
+			polynomials.sizes_at_zero[i] = size_at_zero / ((float)window_size + 1.0f);
+			polynomials.sizes_at_one[i] = size_at_one / ((float)window_size + 1.0f);
+		}
+	}, 256);
+
+	polynomials.inverted = sm.inverted;
+	polynomials.colors_valid = true;
+}
+
+void fractal_engine::evaluateRefreshPolynomials(float t, vertex_streams &points)
+{
+	long long count = polynomials.vertex_count;
+	int degree = polynomials.degree;
+	const float *coefficients = polynomials.position_coefficients.data();
+	long long block_floats = (long long)(degree + 1) * 3 * REFRESH_POLYNOMIAL_BLOCK;
+
+	// factoring out (1 - t)^degree leaves a plain polynomial in t / (1 - t), and factoring out t^degree one in (1 - t) / t.
+	// whichever ratio is at most one is used as the horner variable, so the sums stay within the range of the coefficients
+	bool from_front = t > 0.5f;
+	float ratio = from_front ? (1.0f - t) / t : t / (1.0f - t);
+	float scale = std::pow(from_front ? t : 1.0f - t, (float)degree);
+
+	// coefficients are stored block by block, so work is split on block boundaries
+	long long total_blocks = (count + REFRESH_POLYNOMIAL_BLOCK - 1) / REFRESH_POLYNOMIAL_BLOCK;
+
+	workers.parallelFor(total_blocks, [&](long long first_block, long long end_block) {
+		float sums[3][REFRESH_POLYNOMIAL_BLOCK];
+
+		for (long long block = first_block; block < end_block; block++)
+		{
+			long long block_start = block * REFRESH_POLYNOMIAL_BLOCK;
+			int block_count = (int)min((long long)REFRESH_POLYNOMIAL_BLOCK, count - block_start);
+			const float *block_coefficients = coefficients + (block * block_floats);
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float *sum = sums[axis];
+
+				// the highest power of the ratio multiplies coefficient degree when expanding from the back, coefficient 0 from the front
+				for (int step = 0; step <= degree; step++)
+				{
+					int k = from_front ? step : degree - step;
+					const float *coefficient = block_coefficients + (((k * 3) + axis) * REFRESH_POLYNOMIAL_BLOCK);
+
+					if (step == 0)
+					{
+						for (int j = 0; j < block_count; j++)
+							sum[j] = coefficient[j];
+					}
+
+					else
+					{
+						for (int j = 0; j < block_count; j++)
+							sum[j] = (sum[j] * ratio) + coefficient[j];
+					}
+				}
+			}
+
+			// indexed colors aren't stored, and the color tables may be out of date for them
+			if (points.hasIndexedColors())
+			{
+				for (int j = 0; j < block_count; j++)
+					points.setVertex(block_start + j, vec4(sums[0][j] * scale, sums[1][j] * scale, sums[2][j] * scale, 1.0f), vec4(0.0f), 0.0f);
+			}
+
+			else
+			{
+				for (int j = 0; j < block_count; j++)
+				{
+					long long i = block_start + j;
+					points.setVertex(i, vec4(sums[0][j] * scale, sums[1][j] * scale, sums[2][j] * scale, 1.0f),
+						influenceElement<vec4>(polynomials.colors_at_zero[i], polynomials.colors_at_one[i], t),
+						influenceElement<float>(polynomials.sizes_at_zero[i], polynomials.sizes_at_one[i], t));
+				}
+			}
+		}
+	}, 4);
+}
+
+void fractal_engine::regenerateFractal()
+{
+	long long allocations_before = getHeapAllocationCount();
+
+	if (sm.refresh_enabled)
+	{
+		if (sm.use_point_sequence)
+			generateFractalFromPointSequenceWithRefresh();
+
+		else generateFractalWithRefresh();
+	}
+
+	else
+	{
+		if (sm.use_point_sequence)
+			generateFractalFromPointSequence();
+
+		else generateFractal();
+	}
+
+	last_generation_allocations = getHeapAllocationCount() - allocations_before;
+}
+
+generated_frame &fractal_engine::beginOutput()
+{
+	// everything the last generation left in the arena is dead by now, the output it committed was moved out of the arena
+	arena.reset();
+
+	spare_output.line_indices.clear();
+	spare_output.triangle_indices.clear();
+	spare_output.point_vertex_indices.clear();
+	spare_output.vertex_multiplicity.clear();
+
+	return spare_output;
+}
+
+void fractal_engine::commitOutput()
+{
+	// the previous output becomes the spare, so its storage is written by the next generation instead of freed
+	vertex_data.swap(spare_output.vertex_data);
+	line_indices.swap(spare_output.line_indices);
+	triangle_indices.swap(spare_output.triangle_indices);
+	point_vertex_indices.swap(spare_output.point_vertex_indices);
+	vertex_multiplicity.swap(spare_output.vertex_multiplicity);
+
+	computePointStatistics();
+}
+
+bool fractal_engine::recolorFractal()
+{
+	arena.reset();
+
+	// indexed colors are resolved by the renderer from the current colors, there is nothing stored to recolor
+	if (vertex_data.hasIndexedColors())
+		return true;
+
+	if (!sm.smooth_render || sm.use_point_sequence || frontSlot().matrices.empty() || vertex_data.empty())
+		return false;
+
+	if (!sm.refresh_enabled)
+	{
+		// the chain's colors follow their own recurrence, independent of the points
+		if (vertex_data.size() != vertex_count)
+			return false;
+
+		recolorChain();
+		return true;
+	}
+
+	if (sm.refresh_value <= 0)
+		return false;
+
+	// deduplicated generations hold one vertex per distinct window, every other generation one per point
+	if (point_vertex_indices.empty() && vertex_data.size() != vertex_count)
+		return false;
+
+	recolorRefreshPoints(sm.refresh_value);
+	return true;
+}
+
+void fractal_engine::recolorRefreshPoints(int window_size)
+{
+	const vector<refresh_step> &steps = interpolated_steps;
+	buildInterpolatedSteps(interpolated_steps);
+
+	long long count = vertex_data.size();
+	frame_vector<long long> window_starts(arena);
+	if (!point_vertex_indices.empty())
+		findVertexWindowStarts(point_vertex_indices, count, window_starts);
+
+	const generation_slot &front = frontSlot();
+	const generation_slot &back = backSlot();
+	int num_back = back.matrices.size();
+	int sequence_size = front.matrix_sequence.size();
+	vec4 base_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+
+	// the same sums writeRefreshVertex divides, without composing any matrices
+	workers.parallelFor(count, [&](long long begin, long long end) {
+		for (long long i = begin; i < end; i++)
+		{
+			long long start = window_starts.empty() ? i : window_starts[i];
+			vec4 point_color = base_color;
+			float new_size = POINT_SCALE_MAX;
+
+			for (int n = 0; n < window_size; n++)
+			{
+				long long sequence_index = (start + n) % sequence_size;
+				const refresh_step &step = steps[front.matrix_sequence[sequence_index] * num_back + back.matrix_sequence[sequence_index]];
+				point_color += step.color;
+				new_size += step.size;
+			}
+
+			vertex_data.setColor(i, point_color / ((float)window_size + 1.0f), new_size / ((float)window_size + 1.0f));
+		}
+	}, 256);
+}
+
+void fractal_engine::recolorChain()
+{
+	vec4 point_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+	float point_size = POINT_SCALE_MAX;
+
+	// serial, each step is a handful of blends and the whole chain costs less than uploading it
+	for (long long i = 0; i < vertex_data.size(); i++)
+	{
+		int matrix_index_front = frontSlot().matrix_sequence.at(i);
+		int matrix_index_back = backSlot().matrix_sequence.at(i);
+
+		vec4 matrix_color_front = influenceElement<vec4>(point_color, frontSlot().colors.at(matrix_index_front), sm.bias_coefficient);
+		vec4 matrix_color_back = influenceElement<vec4>(point_color, backSlot().colors.at(matrix_index_back), sm.bias_coefficient);
+
+		float point_size_front = influenceElement<float>(point_size, frontSlot().sizes.at(matrix_index_front), sm.bias_coefficient);
+		float point_size_back = influenceElement<float>(point_size, backSlot().sizes.at(matrix_index_back), sm.bias_coefficient);
+
+		point_color = influenceElement<vec4>(matrix_color_back, matrix_color_front, sm.interpolation_state);
+		point_size = influenceElement<float>(point_size_back, point_size_front, sm.interpolation_state);
+
+		vertex_data.setColor(i, point_color, point_size);
+	}
+}
+
+bool fractal_engine::prepareExternalRefreshGeneration()
+{
+	if (!canGenerateRefreshExternally())
+		return false;
+
+	// the window size is drawn exactly as generateFractalWithRefresh draws it, so rg stays in step with cpu generation
+	signed int actual_refresh = sm.refresh_value == -1 ? int(rg.getRandomFloatInRange(sm.refresh_min, sm.refresh_max)) : sm.refresh_value;
+	if (actual_refresh <= 0)
+		return false;
+
+	sm.interpolation_state = glm::clamp(sm.interpolation_state, 0.0f, 1.0f);
+
+	refresh_window_size = actual_refresh;
+	buildInterpolatedSteps(refresh_steps);
+
+	vertex_data.clear();
+	line_indices.clear();
+	triangle_indices.clear();
+	point_vertex_indices.clear();
+	vertex_multiplicity.clear();
+
+	arena.reset();
+	long long sample_count = min(vertex_count, (long long)EXTERNAL_STATISTICS_SAMPLES);
+	statistics_samples.resize(sample_count);
+
+	for (long long i = 0; i < sample_count; i++)
+	{
+		long long point_index = (i * vertex_count) / sample_count;
+		writeRefreshVertex(composeRefreshWindow(point_index, refresh_window_size, refresh_steps), refresh_window_size, statistics_samples, i);
+	}
+
+	computePointStatistics(statistics_samples, vertex_multiplicity);
+	stats.point_count = vertex_count;
+
+	return true;
+}
+
+void fractal_engine::swapOutput(generated_frame &frame)
+{
+	vertex_data.swap(frame.vertex_data);
+	line_indices.swap(frame.line_indices);
+	triangle_indices.swap(frame.triangle_indices);
+	point_vertex_indices.swap(frame.point_vertex_indices);
+	vertex_multiplicity.swap(frame.vertex_multiplicity);
+	std::swap(stats, frame.stats);
+	frame.interpolation_state = sm.interpolation_state;
+}
+
+void fractal_engine::getExternalRefreshVertex(long long point_index, vec4 &position, vec4 &color, float &size) const
+{
+	composeRefreshVertex(composeRefreshWindow(point_index, refresh_window_size, refresh_steps), refresh_window_size, position, color, size);
+}
+
+bool fractal_engine::tickInterpolation()
+{
+	float increment_coefficient = 1.0f - (std::abs(0.5f - sm.interpolation_state) * 2.0f);
+
+	float actual_increment = glm::clamp(sm.interpolation_increment * increment_coefficient * increment_coefficient, sm.interpolation_increment * 0.05f, sm.interpolation_increment);
+
+	sm.reverse ? sm.interpolation_state -= actual_increment : sm.interpolation_state += actual_increment;
+
+	if (sm.interpolation_state <= 0.0f)
+	{
+		sm.interpolation_state = 1.0f;
+		swapMatrices();
+		return true;
+	}
+
+	else if (sm.interpolation_state >= 1.0f)
+	{
+		sm.interpolation_state = 0.0f;
+		swapMatrices();
+		return true;
+	}
+
+	return false;
+}
+
+vector<mat4> fractal_engine::generateMatrixSequence(const int &sequence_size) const
+{
+	vector<mat4> matrix_sequence;
+
+	for (int i = 0; i < sequence_size; i++)
+	{
+		int random_index = rg.getRandomUniform() * (float)frontSlot().matrices.size();
+		matrix_sequence.push_back(frontSlot().matrices.at(random_index).second);
+	}
+
+	//return matrix_sequence;
+
+	vector<mat4> dummy_sequence = {
+		glm::translate(mat4(1.0f), vec3(0.01f, 0.01f, 0.0f)),
+		glm::rotate(mat4(1.0f), 0.05f, vec3(0.0f, 0.0f, 1.0f)),
+		glm::translate(mat4(1.0f), vec3(0.02f, -0.01f, 0.0f)),
+		glm::translate(mat4(1.0f), vec3(-0.01f, 0.02f, 0.0f)),
+		glm::rotate(mat4(1.0f), 0.02f, vec3(0.0f, 0.0f, 1.0f))
+	};
+
+	return dummy_sequence;
+}
+
+void fractal_engine::addNewPointAndIterate(
+	vec4 &starting_point,
+	vec4 &starting_color,
+	float &starting_size,
+	int matrix_index_front,
+	int matrix_index_back,
+	vertex_streams &points,
+	long long index) const
+{
+	const mat4 &matrix_front = frontSlot().matrices.at(matrix_index_front).second;
+	const mat4 &matrix_back = backSlot().matrices.at(matrix_index_back).second;
+	vec4 point_front = matrix_front * starting_point;
+	vec4 point_back = matrix_back * starting_point;
+
+	vec4 matrix_color_front = influenceElement<vec4>(starting_color, frontSlot().colors.at(matrix_index_front), sm.bias_coefficient);
+	vec4 matrix_color_back = influenceElement<vec4>(starting_color, backSlot().colors.at(matrix_index_back), sm.bias_coefficient);
+
+	float point_size_front = influenceElement<float>(starting_size, frontSlot().sizes.at(matrix_index_front), sm.bias_coefficient);
+	float point_size_back = influenceElement<float>(starting_size, backSlot().sizes.at(matrix_index_back), sm.bias_coefficient);
+
+	starting_point = influenceElement<vec4>(point_back, point_front, sm.interpolation_state);
+	starting_color = influenceElement<vec4>(matrix_color_back, matrix_color_front, sm.interpolation_state);
+	starting_size = influenceElement<float>(point_size_back, point_size_front, sm.interpolation_state);
+
+	points.setVertex(index, starting_point, starting_color, starting_size);
+}
+
+void fractal_engine::iteratePointSequence(
+	mat4 &origin_matrix,
+	vec4 &starting_color,
+	float &starting_size,
+	int matrix_index_front,
+	int matrix_index_back,
+	vector<unsigned int> &line_indices,
+	vector<unsigned int> &triangle_indices,
+	long long &current_sequence_index_lines,
+	long long &current_sequence_index_triangles)
+{
+	mat4 matrix_front = frontSlot().matrices.at(matrix_index_front).second;
+	mat4 matrix_back = backSlot().matrices.at(matrix_index_back).second;
+	mat4 interpolated_matrix = influenceElement<mat4>(matrix_back, matrix_front, sm.interpolation_state);
+	mat4 final_matrix = interpolated_matrix * origin_matrix;
+
+	vec4 matrix_color_front = influenceElement<vec4>(starting_color, frontSlot().colors.at(matrix_index_front), sm.bias_coefficient);
+	vec4 matrix_color_back = influenceElement<vec4>(starting_color, backSlot().colors.at(matrix_index_back), sm.bias_coefficient);
+
+	float point_size_front = influenceElement<float>(starting_size, frontSlot().sizes.at(matrix_index_front), sm.bias_coefficient);
+	float point_size_back = influenceElement<float>(starting_size, backSlot().sizes.at(matrix_index_back), sm.bias_coefficient);
+
+	starting_color = influenceElement<vec4>(matrix_color_back, matrix_color_front, sm.interpolation_state);
+	starting_size = influenceElement<float>(point_size_back, point_size_front, sm.interpolation_state);
+
+	// determine where values should begin based on the used sequence and number of indices already added
+	vector<int>::iterator max_local_value_lines = std::max_element(sm.line_indices.begin(), sm.line_indices.end());
+	long long starting_index_lines = current_sequence_index_lines;
+	for (const int index : sm.line_indices)
+	{
+		line_indices.push_back(starting_index_lines + index);
+	}
+
+	current_sequence_index_lines += *max_local_value_lines;
+
+	vector<int>::iterator max_local_value_triangles = std::max_element(sm.triangle_indices.begin(), sm.triangle_indices.end());
+	long long starting_index_triangles = current_sequence_index_triangles;
+	for (const int index : sm.triangle_indices)
+	{
+		triangle_indices.push_back(starting_index_triangles + index);
+	}
+
+	current_sequence_index_triangles += *max_local_value_triangles;
+
+	origin_matrix = final_matrix;
+}
+
+void fractal_engine::addPointSequenceInstances(
+	const frame_vector<affine_matrix> &instance_matrices,
+	const frame_vector<vec4> &instance_colors,
+	const frame_vector<float> &instance_sizes,
+	vertex_streams &points)
+{
+	long long sequence_size = sm.point_sequence.size();
+	long long point_count = instance_matrices.size() * sequence_size;
+
+	// every instance repeats the sequence's points, each transformed by that instance's matrix
+	frame_vector<int> instance_indices(point_count, 0, arena);
+	frame_vector<float> x(point_count, 0.0f, arena);
+	frame_vector<float> y(point_count, 0.0f, arena);
+	frame_vector<float> z(point_count, 0.0f, arena);
+
+	for (long long i = 0; i < point_count; i++)
+	{
+		const vec4 &sequence_point = sm.point_sequence[i % sequence_size];
+		instance_indices[i] = int(i / sequence_size);
+		x[i] = sequence_point.x;
+		y[i] = sequence_point.y;
+		z[i] = sequence_point.z;
+	}
+
+	workers.parallelFor(point_count, [&](long long begin, long long end) {
+		transformPointsIndexed(instance_matrices.data(), &instance_indices[begin], &x[begin], &y[begin], &z[begin], end - begin);
+	});
+
+	workers.parallelFor(point_count, [&](long long begin, long long end) {
+		for (long long i = begin; i < end; i++)
+		{
+			points.setVertex(i, vec4(x[i], y[i], z[i], 1.0f), instance_colors[instance_indices[i]], instance_sizes[instance_indices[i]]);
+		}
+	});
+}
+
+vec4 fractal_engine::getSampleColor(const int &samples, const vector<vec4> &color_pool) const
+{
+	if (samples > color_pool.size())
+	{
+		cout << "color samples requested are greater than the number of colors in the targeted generator" << endl;
+		return vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	vec4 out_color(0.0f, 0.0f, 0.0f, 0.0f);
+
+	if (samples <= 0)
+		return out_color;
+
+	for (int i = 0; i < samples; i++)
+	{
+		int random_index = (int)(rg.getRandomUniform() * color_pool.size());
+		out_color += color_pool.at(random_index);
+	}
+
+	out_color /= (float)samples;
+	return out_color;
+}
+
+vec4 fractal_engine::getInterpolatedColor(int index) const
+{
+	return influenceElement<vec4>(backSlot().colors.at(index), frontSlot().colors.at(index), sm.interpolation_state);
+}
+
+void fractal_engine::newColors()
+{
+	// a prefetch started from color_man's state before these draws, so it would no longer match an inline swap
+	cancelSlotPrefetch();
+
+	frontSlot().seed_color = rg.getRandomVec4FromColorRanges(
+		0.0f, 1.0f,		// red range
+		0.0f, 1.0f,		// green range
+		0.0f, 1.0f,		// blue range
+		sm.alpha_min, sm.alpha_max		// alpha range
+		);
+
+	backSlot().seed_color = rg.getRandomVec4FromColorRanges(
+		0.0f, 1.0f,		// red range
+		0.0f, 1.0f,		// green range
+		0.0f, 1.0f,		// blue range
+		sm.alpha_min, sm.alpha_max		// alpha range
+		);
+
+	int count = frontSlot().matrices.size();
+	frontSlot().colors = generateColorVector(frontSlot().seed_color, count, sm.random_palette_front, getSlotParameters(sm.generation, true, count), rg, color_man);
+	backSlot().colors = generateColorVector(backSlot().seed_color, count, sm.random_palette_back, getSlotParameters(sm.generation, false, count), rg, color_man);
+
+	// positions don't depend on colors, so the polynomial coefficients stay valid
+	polynomials.colors_valid = false;
+}
+
+void fractal_engine::printContext() const
+{
+	cout << "------------------------------------------------" << endl;
+	cout << "base seed: " << base_seed << endl;
+	cout << "generation seed: " << generation_seed << endl;
+	cout << "current generation: " << sm.generation;
+	sm.reverse ? cout << " <-" << endl : cout << " ->" << endl;
+
+	printMatrices();
+
+	cout << "point count: " << vertex_count << endl;
+	cout << "point kernels: " << getStringFromKernelInstructionSet(getKernelInstructionSet()) << endl;
+	sm.refresh_enabled ? cout << "refresh enabled (" << sm.refresh_value << ")" << endl : cout << "refresh disabled" << endl;
+	cout << "centroid: " + glm::to_string(stats.centroid) << endl;
+	cout << "mean distance: " << stats.mean_distance << endl;
+	cout << "min bounds: " + glm::to_string(stats.min_bounds) << endl;
+	cout << "max bounds: " + glm::to_string(stats.max_bounds) << endl;
+	if (sm.compute_point_variance)
+		cout << "variance: " + glm::to_string(stats.variance) << endl;
+
+	cout << "front palette: " + color_man.getPaletteName(sm.palette_front) << endl;
+	if (sm.palette_front == RANDOM_PALETTE)
+		cout << "current front palette: " + color_man.getPaletteName(sm.random_palette_front) << endl;
+
+	cout << "front color set, seed = " + color_man.toRGBAString(frontSlot().seed_color) + ":" << endl;
+	color_man.printColorSet(frontSlot().colors);
+	cout << "front background index: " << sm.background_front_index << endl;
+	cout << endl;
+
+	cout << "back palette: " + color_man.getPaletteName(sm.palette_back) << endl;
+	if (sm.palette_back == RANDOM_PALETTE)
+		cout << "current back palette: " + color_man.getPaletteName(sm.random_palette_back) << endl;
+
+	cout << "back color set, seed = " + color_man.toRGBAString(backSlot().seed_color) + ":" << endl;
+	color_man.printColorSet(backSlot().colors);
+	cout << "back background index: " << sm.background_back_index << endl;
+	cout << endl;
+
+	cout << "line width: " << sm.line_width << endl;
+	cout << "interpolation state: " << sm.interpolation_state << endl;
+	cout << "current scale: " << sm.fractal_scale << endl;
+	cout << "bias coefficient: " << sm.bias_coefficient << endl;
+	sm.smooth_render ? cout << "smooth rendering enabled" << endl : cout << "smooth rendering disabled" << endl;
+	sm.randomize_lightness ? cout << "lightness randomization enabled" << endl : cout << "lightness randomization disabled" << endl;
+	sm.randomize_alpha ? cout << "alpha randomization enabled (" << sm.alpha_min << ", " << sm.alpha_max << ")" << endl : cout << "alpha randomization disabled" << endl;
+	sm.refresh_enabled ? cout << "refresh mode enabled (" << sm.refresh_value << ")" << endl : cout << "refresh mode disabled" << endl;
+	sm.two_dimensional ? cout << "2D mode enabled" << endl : cout << "2D mode disabled" << endl;
+	sm.scale_matrices ? cout << "scale matrices enabled" << endl : cout << "scale matrices disabled" << endl;
+	if (sm.inverted)
+		cout << "inverted colors" << endl;
+	//cout << "geometry draw type: " << getStringFromGeometryType(sm.geo_type) << endl;
+	cout << "lighting mode: " << getStringFromLightingMode(sm.lm) << endl;
+	cout << "front geometry matrix type: " << getStringFromGeometryType(frontSlot().geo_type) << endl;
+	cout << "back geometry matrix type: " << getStringFromGeometryType(backSlot().geo_type) << endl;
+	cout << "matrix geometry coefficient: " << sm.matrix_geometry_coefficient << endl;
+	cout << "matrix geometry map: " << endl;
+	for (const auto &geo_pair : sm.matrix_geometry_weights)
+	{
+		cout << geo_pair.first << ": " << geo_pair.second << endl;
+	}
+
+	cout << "-----------------------------------------------" << endl;
+	cout << sm.toString() << endl;
+	cout << "-----------------------------------------------" << endl;
+}
+
+void fractal_engine::cycleGeometryType()
+{
+	if (sm.point_sequence_index == GEOMETRY_ENUM_COUNT)
+		sm.point_sequence_index = 0;
+
+	else sm.point_sequence_index++;
+
+	sm.use_point_sequence = GEOMETRY_ENUM_COUNT != sm.point_sequence_index;
+
+	if (sm.use_point_sequence)
+	{
+		sm.setPointSequenceGeometry(sm.point_sequence_index, rg);
+	}
+
+	cout << "point sequence index: " << sm.point_sequence_index << endl;
+}
+
+string fractal_engine::getStringFromGeometryType(geometry_type gt) const
+{
+	switch (gt)
+	{
+	case CUBOID: return "cuboid";
+	case CUBE: return "cube";
+	case TETRAHEDRON: return "tetrahedron";
+	case OCTAHEDRON: return "octahedron";
+	case DODECAHEDRON: return "dodecahedron";
+	case ICOSAHEDRON: return "icosahedron";
+	//case LOADED_SEQUENCE: return loaded_sequences.at(current_sequence).first;
+	case GEOMETRY_TYPE_SIZE: return "points";
+	default: return "unknown type";
+	}
+}
+
+void fractal_engine::generateLights()
+{
+	light_indices.clear();
+	long long light_index_spacing = sm.num_points / sm.num_lights;
+
+	for (int i = 0; i < sm.num_lights; i++)
+	{
+		light_indices.push_back(i * light_index_spacing);
+	}
+}
+
+// fixed block boundaries make the summation order, and so the result, independent of thread count
+template <typename partial_vector, typename block_reducer>
+static void reduceInBlocks(thread_pool &workers, long long count, partial_vector &partials, block_reducer reduce_block)
+{
+	long long block_count = (count + STATISTICS_BLOCK_SIZE - 1) / STATISTICS_BLOCK_SIZE;
+	partials.assign(block_count, typename partial_vector::value_type());
+
+	workers.parallelFor(block_count, [&](long long begin, long long end) {
+		for (long long block = begin; block < end; block++)
+		{
+			reduce_block(block * STATISTICS_BLOCK_SIZE, min(count, (block + 1) * STATISTICS_BLOCK_SIZE), partials[block]);
+		}
+	}, 1);
+}
+
+void fractal_engine::computePointStatistics()
+{
+	computePointStatistics(vertex_data, vertex_multiplicity);
+}
+
+void fractal_engine::computePointStatistics(const vertex_streams &points, const vector<unsigned int> &multiplicity)
+{
+	stats = point_statistics();
+
+	const vector<vec4> &positions = points.getPositions();
+	long long count = points.size();
+
+	if (count == 0)
+		return;
+
+	// sums are kept in double so large generations don't lose the contribution of late points
+	struct extent_partial
+	{
+		double weight = 0.0;
+		double sum[3] = { 0.0, 0.0, 0.0 };
+		vec3 min_bounds = vec3(FLT_MAX);
+		vec3 max_bounds = vec3(-FLT_MAX);
+	};
+
+	frame_vector<extent_partial> extents(arena);
+	reduceInBlocks(workers, count, extents, [&](long long begin, long long end, extent_partial &partial) {
+		for (long long i = begin; i < end; i++)
+		{
+			const vec4 &position = positions[i];
+			double weight = multiplicity.empty() ? 1.0 : double(multiplicity[i]);
+
+			partial.weight += weight;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				partial.sum[axis] += weight * position[axis];
+			}
+
+			partial.min_bounds = glm::min(partial.min_bounds, vec3(position));
+			partial.max_bounds = glm::max(partial.max_bounds, vec3(position));
+		}
+	});
+
+	extent_partial total;
+	for (const extent_partial &partial : extents)
+	{
+		total.weight += partial.weight;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			total.sum[axis] += partial.sum[axis];
+		}
+
+		total.min_bounds = glm::min(total.min_bounds, partial.min_bounds);
+		total.max_bounds = glm::max(total.max_bounds, partial.max_bounds);
+	}
+
+	stats.point_count = (long long)total.weight;
+	stats.centroid = vec3(float(total.sum[0] / total.weight), float(total.sum[1] / total.weight), float(total.sum[2] / total.weight));
+	stats.min_bounds = total.min_bounds;
+	stats.max_bounds = total.max_bounds;
+
+	// distances depend on the finished centroid, so they need a second pass
+	struct spread_partial
+	{
+		double distance = 0.0;
+		double squared[3] = { 0.0, 0.0, 0.0 };
+	};
+
+	bool compute_variance = sm.compute_point_variance;
+	vec3 centroid = stats.centroid;
+
+	frame_vector<spread_partial> spreads(arena);
+	reduceInBlocks(workers, count, spreads, [&](long long begin, long long end, spread_partial &partial) {
+		for (long long i = begin; i < end; i++)
+		{
+			vec3 offset = vec3(positions[i]) - centroid;
+			double weight = multiplicity.empty() ? 1.0 : double(multiplicity[i]);
+
+			partial.distance += weight * glm::length(offset);
+
+			if (compute_variance)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					partial.squared[axis] += weight * offset[axis] * offset[axis];
+				}
+			}
+		}
+	});
+
+	spread_partial spread;
+	for (const spread_partial &partial : spreads)
+	{
+		spread.distance += partial.distance;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			spread.squared[axis] += partial.squared[axis];
+		}
+	}
+
+	stats.mean_distance = float(spread.distance / total.weight);
+
+	if (compute_variance)
+		stats.variance = vec3(float(spread.squared[0] / total.weight), float(spread.squared[1] / total.weight), float(spread.squared[2] / total.weight));
+}
+
+void fractal_engine::addSequentialIndices(long long point_count, vector<unsigned int> &line_indices_to_buffer, vector<unsigned int> &triangle_indices_to_buffer) const
+{
+	line_indices_to_buffer.resize(point_count);
+	triangle_indices_to_buffer.resize(point_count);
+
+	for (long long i = 0; i < point_count; i++)
+	{
+		line_indices_to_buffer[i] = i;
+		triangle_indices_to_buffer[i] = i;
+	}
+}
@@ -0,0 +1,445 @@
+#pragma once
+
+#ifndef FRACTAL_ENGINE_H
+#define FRACTAL_ENGINE_H
+
+#include "engine_header.h"
+#include "random_generator.h"
+#include "color_manager.h"
+#include "settings_manager.h"
+#include "geometry_generator.h"
+#include "thread_pool.h"
+#include "vertex_streams.h"
+#include "affine_kernels.h"
+#include "frame_arena.h"
+#include <thread>
+
+// fewest points each block of a parallel chaos game chain is given, below this the chain is generated serially
+#define PARALLEL_CHAIN_BLOCK_MIN 4096
+
+// points per partial sum of the statistics reduction
+#define STATISTICS_BLOCK_SIZE 16384
+
+// windows sampled for statistics when refresh points are generated outside the engine
+#define EXTERNAL_STATISTICS_SAMPLES 4096
+
+// most floats of refresh polynomial coefficients kept between frames, larger generations are built directly every frame
+#define MAX_REFRESH_POLYNOMIAL_FLOATS 67108864
+
+// vertices evaluated together when refresh polynomials are expanded into points
+#define REFRESH_POLYNOMIAL_BLOCK 256
+
+// points whose matrix indices and coordinates are held at once when unsmoothed refresh points are generated
+#define REFRESH_POINT_BLOCK 65536
+
+// summary of the most recent generation, computed in one reduction pass after the points are finished
+// points that share a deduplicated vertex are each counted, so the values match undeduplicated output
+struct point_statistics
+{
+	long long point_count = 0;
+	vec3 centroid = vec3(0.0f);
+	// mean distance from each point to the centroid
+	float mean_distance = 0.0f;
+	vec3 min_bounds = vec3(0.0f);
+	vec3 max_bounds = vec3(0.0f);
+	// per axis, left at zero unless compute_point_variance is set
+	vec3 variance = vec3(0.0f);
+};
+
+// output of one generation, swapped out of the engine so it can be handed between threads without copying
+struct generated_frame
+{
+	vertex_streams vertex_data;
+	vector<unsigned int> line_indices;
+	vector<unsigned int> triangle_indices;
+	vector<unsigned int> point_vertex_indices;
+	vector<unsigned int> vertex_multiplicity;
+	point_statistics stats;
+	float interpolation_state = 0.0f;
+
+	void swap(generated_frame &other)
+	{
+		vertex_data.swap(other.vertex_data);
+		line_indices.swap(other.line_indices);
+		triangle_indices.swap(other.triangle_indices);
+		point_vertex_indices.swap(other.point_vertex_indices);
+		vertex_multiplicity.swap(other.vertex_multiplicity);
+		std::swap(stats, other.stats);
+		std::swap(interpolation_state, other.interpolation_state);
+	}
+};
+
+// headless point generation, owns every piece of seeded fractal state and produces vertex, index, and statistics data
+// contains no GL calls so it can be linked by the viewer and by command line tools alike
+class fractal_engine
+{
+public:
+	// one interpolated front/back matrix pair and its color and size, or the composite of a window of them
+	struct refresh_step
+	{
+		mat4 matrix;
+		vec4 color;
+		float size;
+	};
+
+	fractal_engine(const string &randomization_seed, long long num_points);
+	~fractal_engine();
+
+	string getSeed() const { return base_seed; }
+	string getGenerationSeed() const { return generation_seed; }
+
+	void setMatrices();
+	void swapMatrices();
+
+	void generateFractal();
+	void generateFractalFromPointSequence();
+	void generateFractalWithRefresh();
+	void generateFractalFromPointSequenceWithRefresh();
+
+	// runs the generation method selected by the current settings
+	void regenerateFractal();
+
+	// heap allocations made by every thread during the last regenerateFractal, only counted when COUNT_HEAP_ALLOCATIONS is defined
+	// generation reuses its output buffers and takes temporaries from an arena, so this reaches zero once animation settles
+	long long getLastGenerationAllocations() const { return last_generation_allocations; }
+
+	// recomputes only the colors and sizes of the last generation from the current colors, leaving positions and indices as they
+	// were. returns false without changing anything when they can't be recovered without generating again: the matrix indices of
+	// unsmoothed generations were drawn from rg, as were random refresh window sizes, and point sequences aren't supported
+	bool recolorFractal();
+
+	// smooth refresh points depend only on the interpolated step table and the matrix sequences, so they can be built outside
+	// the engine, e.g. by the viewer's compute shader. used in place of regenerateFractal, this picks the window size and builds
+	// the step table but no points: vertex and index data are left empty and statistics are estimated from a sample of windows
+	// returns false without changing anything when the current settings don't produce smooth refresh points
+	bool prepareExternalRefreshGeneration();
+	bool canGenerateRefreshExternally() const { return sm.refresh_enabled && !sm.use_point_sequence && sm.smooth_render && !frontSlot().matrices.empty(); }
+
+	// generations made under these settings have indexed colors, with refresh_value as every point's window size
+	bool canIndexRefreshColors() const { return sm.indexed_refresh_colors && canGenerateRefreshExternally() && sm.refresh_value > 0; }
+
+	// the color a renderer resolves for point_index of a generation with indexed colors
+	vec4 getIndexedColor(long long point_index) const;
+
+	// when the last generation was deduplicated, the first point of each vertex's window, where the renderer starts summing
+	void getVertexWindowStarts(vector<unsigned int> &window_starts) const;
+
+	// valid after prepareExternalRefreshGeneration, steps are indexed by front * getRefreshStepBackCount() + back
+	int getRefreshWindowSize() const { return refresh_window_size; }
+	const vector<refresh_step> &getRefreshSteps() const { return refresh_steps; }
+	int getRefreshStepBackCount() const { return backSlot().matrices.size(); }
+	vec4 getOrigin() const { return origin; }
+
+	// the vertex an external refresh generation places at point_index
+	void getExternalRefreshVertex(long long point_index, vec4 &position, vec4 &color, float &size) const;
+
+	const vector<unsigned int> &getMatrixSequenceFront() const { return frontSlot().matrix_sequence; }
+	const vector<unsigned int> &getMatrixSequenceBack() const { return backSlot().matrix_sequence; }
+
+	// changes whenever the matrix sequences do, so copies of them held elsewhere know when to refresh
+	unsigned int getMatrixSequenceVersion() const { return matrix_sequence_version; }
+
+	// advances interpolation_state, swapping matrices when a transition completes. returns true if a swap occurred
+	bool tickInterpolation();
+
+	void newColors();
+	void cycleColorPalette();
+	void cycleGeometryType();
+	void generateLights();
+
+	vector<mat4> generateMatrixSequence(const int &sequence_size) const;
+	vec4 getSampleColor(const int &samples, const vector<vec4> &color_pool) const;
+	vec4 getInterpolatedColor(int index) const;
+
+	void printMatrices() const;
+	void printContext() const;
+
+	const vertex_streams &getVertexStreams() const { return vertex_data; }
+	const vector<unsigned int> &getLineIndices() const { return line_indices; }
+	const vector<unsigned int> &getTriangleIndices() const { return triangle_indices; }
+	const vector<long long> &getLightIndices() const { return light_indices; }
+
+	// when smooth refresh points were deduplicated, vertex data holds one vertex per distinct window and every point maps to one of them
+	// the index buffers then reference vertices through this map, so strip modes must be drawn indexed as well
+	bool isDeduplicated() const { return !point_vertex_indices.empty(); }
+	long long getVertexIndexOfPoint(long long point_index) const { return point_vertex_indices.empty() ? point_index : point_vertex_indices.at(point_index); }
+	const vector<unsigned int> &getVertexMultiplicity() const { return vertex_multiplicity; }
+	long long getVertexCount() const { return vertex_count; }
+
+	// exchanges the output of the last generation with frame's contents. interpolation_state is recorded, not exchanged
+	void swapOutput(generated_frame &frame);
+
+	const point_statistics &getPointStatistics() const { return stats; }
+
+	settings_manager &getSettings() { return sm; }
+	const settings_manager &getSettings() const { return sm; }
+	const color_manager &getColorManager() const { return color_man; }
+
+	const vector<vec4> &getColorsFront() const { return frontSlot().colors; }
+	const vector<vec4> &getColorsBack() const { return backSlot().colors; }
+	const vector<float> &getSizesFront() const { return frontSlot().sizes; }
+	const vector<float> &getSizesBack() const { return backSlot().sizes; }
+	float getInterpolationState() const { return sm.interpolation_state; }
+	signed int getGeneration() const { return sm.generation; }
+
+	string getStringFromGeometryType(geometry_type gt) const;
+
+private:
+	// composite of a run of chaos game steps: point' = point_matrix * point, color' = color * scale + color_offset, size' = size * scale + size_offset
+	struct chain_transform
+	{
+		mat4 point_matrix;
+		float scale;
+		vec4 color_offset;
+		float size_offset;
+	};
+
+	// one side of a transition, generation interpolates from the back slot to the front slot
+	struct generation_slot
+	{
+		vector<unsigned int> matrix_sequence;
+		vector< pair<string, mat4> > matrices;
+		vector<vec4> colors;
+		vector<float> sizes;
+		vec4 seed_color;
+		geometry_type geo_type = GEOMETRY_TYPE_SIZE;
+	};
+
+	// everything a swap reads when it generates the incoming slot, a prefetched slot is only used if these still match
+	struct slot_parameters
+	{
+		int generation = 0;
+		// the incoming slot becomes the front when moving forward and the back in reverse
+		bool front = true;
+		int count = 0;
+		color_palette palette = RANDOM_PALETTE;
+		color_palette random_palette = DEFAULT_COLOR_PALETTE;
+		float alpha_min = 0.0f;
+		float alpha_max = 1.0f;
+		bool randomize_alpha = true;
+		bool randomize_lightness = true;
+		float matrix_geometry_coefficient = 0.0f;
+		std::map<int, unsigned int> matrix_geometry_weights;
+		int translate_weight = 0;
+		int rotate_weight = 0;
+		int scale_weight = 0;
+		bool scale_matrices = true;
+		bool two_dimensional = false;
+
+		bool operator==(const slot_parameters &other) const;
+	};
+
+	// the next swap's incoming slot, generated on prefetch_thread while the current transition plays
+	// generator and colors are left in the state the swap's own rg and color_man would have reached, so installing it
+	// changes nothing about what is generated afterwards
+	struct slot_prefetch
+	{
+		slot_parameters parameters;
+		generation_slot slot;
+		int background_index = 0;
+		color_palette random_palette = DEFAULT_COLOR_PALETTE;
+		random_generator generator;
+		color_manager colors;
+	};
+
+	fractal_engine(const fractal_engine &);
+	fractal_engine &operator=(const fractal_engine &);
+
+	settings_manager sm;
+	string base_seed;
+	string generation_seed;
+	// a swap flips front_slot_index and regenerates only the incoming slot's matrices, colors and sizes, the outgoing
+	// slot keeps its contents and the incoming slot keeps its matrix sequence, so nothing is copied
+	generation_slot slots[2];
+	int front_slot_index = 0;
+	unsigned int matrix_sequence_version = 0;
+	random_generator rg;
+	color_manager color_man;
+	geometry_generator gm;
+	point_statistics stats;
+
+	// running while prefetch_pending, only read or written by the engine after it has been joined
+	std::thread prefetch_thread;
+	bool prefetch_pending = false;
+	slot_prefetch prefetch;
+
+	// current gen parameters
+	vec4 origin = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	vector<long long> light_indices;
+
+	long long vertex_count;
+
+	// output of the most recent generation
+	vertex_streams vertex_data;
+	vector<unsigned int> line_indices;
+	vector<unsigned int> triangle_indices;
+	// empty unless the last generation was deduplicated
+	vector<unsigned int> point_vertex_indices;
+	vector<unsigned int> vertex_multiplicity;
+
+	thread_pool workers;
+
+	// temporaries of the generation, recolor or external preparation in progress, reset when the next one begins
+	mutable frame_arena arena;
+
+	// buffers of the generation before last, written by the next generation and then swapped with the output
+	generated_frame spare_output;
+
+	// reused by every cpu generation and recolor, refresh_steps is left to external generations
+	vector<refresh_step> interpolated_steps;
+	vertex_streams statistics_samples;
+
+	long long last_generation_allocations = 0;
+
+	// state of the last prepareExternalRefreshGeneration
+	int refresh_window_size = 0;
+	vector<refresh_step> refresh_steps;
+
+	// each smooth refresh window as a polynomial in interpolation_state, built once per set of matrices and evaluated every frame
+	// window matrices are products of window_size linear interpolations, so positions are kept in bernstein form of that degree:
+	// position(t) = sum over k of coefficient k * (1 - t)^(degree - k) * t^k, which has no cancellation between large coefficients
+	// setMatrices and swapMatrices invalidate everything, newColors only the colors. palette cycling changes neither
+	struct refresh_polynomials
+	{
+		bool valid = false;
+		// set instead of valid when the vertices would exceed MAX_REFRESH_POLYNOMIAL_FLOATS, so the check is not repeated every frame
+		bool refused = false;
+		int degree = 0;
+		long long point_count = 0;
+		bool deduplicate = false;
+
+		// colors are rebuilt on their own when only the colors changed, positions depend on the matrices alone
+		bool colors_valid = false;
+		bool inverted = false;
+
+		long long vertex_count = 0;
+		// vertices are split into blocks of REFRESH_POLYNOMIAL_BLOCK, within a block coefficient k of axis a is contiguous
+		vector<float> position_coefficients;
+		// colors and sizes are sums of linear interpolations, so only their values at t = 0 and t = 1 are kept
+		vector<vec4> colors_at_zero;
+		vector<vec4> colors_at_one;
+		vector<float> sizes_at_zero;
+		vector<float> sizes_at_one;
+		// empty unless the windows were deduplicated
+		vector<unsigned int> vertex_indices;
+		vector<unsigned int> multiplicity;
+	};
+
+	refresh_polynomials polynomials;
+
+	// distinct smooth refresh windows of the matrix sequences, searched once per matrix_sequence_version, window size and count
+	// since the windows only change with the sequences. a failed search is kept too, so it is not repeated every frame
+	struct refresh_window_table
+	{
+		bool searched = false;
+		unsigned int sequence_version = 0;
+		int window_size = 0;
+		long long count = 0;
+
+		// false when the windows cannot be keyed exactly or fewer than half of them repeat, the tables are then empty
+		bool distinct = false;
+		// distinct id per window starting in [0, count), first start of each id and how many windows share it
+		vector<unsigned int> window_ids;
+		vector<long long> window_starts;
+		vector<unsigned int> multiplicity;
+	};
+
+	refresh_window_table refresh_windows;
+
+	// advances the chaos game chain one step and writes the new vertex to points at index
+	void addNewPointAndIterate(
+		vec4 &starting_point,
+		vec4 &starting_color,
+		float &starting_size,
+		int matrix_index_front,
+		int matrix_index_back,
+		vertex_streams &points,
+		long long index) const;
+
+	// resets the arena and clears the spare output for a generation to be written into, commitOutput swaps it in
+	generated_frame &beginOutput();
+	void commitOutput();
+
+	void recolorRefreshPoints(int window_size);
+	void recolorChain();
+
+	chain_transform composeChainTransform(long long begin, long long end, const frame_vector<int> &matrix_indices_front, const frame_vector<int> &matrix_indices_back) const;
+
+	// advances the point sequence chain one instance, leaving that instance's matrix, color, and size in the arguments, and adds its indices
+	void iteratePointSequence(
+		mat4 &origin_matrix,
+		vec4 &starting_color,
+		float &starting_size,
+		int matrix_index_front,
+		int matrix_index_back,
+		vector<unsigned int> &line_indices,
+		vector<unsigned int> &triangle_indices,
+		long long &current_sequence_index_lines,
+		long long &current_sequence_index_triangles);
+
+	// writes every point of every sequence instance to points in order
+	void addPointSequenceInstances(
+		const frame_vector<affine_matrix> &instance_matrices,
+		const frame_vector<vec4> &instance_colors,
+		const frame_vector<float> &instance_sizes,
+		vertex_streams &points);
+
+	// builds every refresh mode point from origin one step at a time, batching each step across all points
+	void generateRefreshPoints(long long point_count, int actual_refresh, vertex_streams &points);
+
+	// fills refresh_windows unless it already holds the search for these sequences, returns its verdict
+	bool findDistinctRefreshWindows(long long count, int window_size);
+
+	refresh_step composeRefreshWindow(long long start, int window_size, const vector<refresh_step> &steps) const;
+
+	// inverse of the vertex index map of a deduplicated generation, the first point of every vertex is where its window starts
+	template <typename start_vector>
+	void findVertexWindowStarts(const vector<unsigned int> &vertex_indices, long long distinct_count, start_vector &window_starts) const;
+	void composeRefreshVertex(const refresh_step &window, int actual_refresh, vec4 &position, vec4 &color, float &size) const;
+	void writeRefreshVertex(const refresh_step &window, int actual_refresh, vertex_streams &points, long long index) const;
+
+	// interpolated step for every front/back matrix index pair, indexed by front * the back slot's matrix count + back
+	void buildInterpolatedSteps(vector<refresh_step> &steps) const;
+
+	// rebuilds polynomials if matrices or settings changed since they were built, returns false if they would exceed MAX_REFRESH_POLYNOMIAL_FLOATS
+	// only the position coefficients are rebuilt, colors are left to updateRefreshPolynomialColors since indexed colors never use them
+	bool updateRefreshPolynomials(long long point_count, int window_size);
+	void updateRefreshPolynomialColors();
+	void evaluateRefreshPolynomials(float t, vertex_streams &points);
+
+	// calls handle_window(i, composite) for each smooth refresh window starting in [begin, end), in amortized constant time per window
+	template <typename window_handler>
+	void aggregateRefreshWindows(long long begin, long long end, int window_size, const vector<refresh_step> &steps, window_handler handle_window) const;
+
+	// recomputes stats from vertex_data, weighting each vertex by its multiplicity when the generation was deduplicated
+	void computePointStatistics();
+	void computePointStatistics(const vertex_streams &points, const vector<unsigned int> &multiplicity);
+
+	// adds one line and triangle index per point, in point order
+	void addSequentialIndices(long long point_count, vector<unsigned int> &line_indices_to_buffer, vector<unsigned int> &triangle_indices_to_buffer) const;
+
+	generation_slot &frontSlot() { return slots[front_slot_index]; }
+	generation_slot &backSlot() { return slots[1 - front_slot_index]; }
+	const generation_slot &frontSlot() const { return slots[front_slot_index]; }
+	const generation_slot &backSlot() const { return slots[1 - front_slot_index]; }
+
+	slot_parameters getSlotParameters(int generation, bool front, int count) const;
+
+	// draws the incoming slot of a swap from generator and colors, in the order swapMatrices always has
+	void generateSlot(const slot_parameters &parameters, random_generator &generator, const color_manager &colors,
+		generation_slot &slot, int &background_index, color_palette &random_palette) const;
+
+	// starts generating the slot the next swap will need, if prefetch_generations is set
+	void startSlotPrefetch();
+	// waits for the prefetch, then moves its slot into incoming and returns true if it was made with these parameters
+	bool takeSlotPrefetch(const slot_parameters &parameters, generation_slot &incoming, int &background_index, color_palette &random_palette);
+	void cancelSlotPrefetch();
+
+	vector< pair<string, mat4> > generateMatrixVector(const int &count, geometry_type &geo_type, const slot_parameters &parameters, random_generator &generator) const;
+	vector<vec4> generateColorVector(const vec4 &seed, const int &count, color_palette &random_selection,
+		const slot_parameters &parameters, random_generator &generator, const color_manager &colors) const;
+	vector<float> generateSizeVector(const int &count, random_generator &generator) const;
+};
+
+#endif
@@ -1,21 +1,36 @@
 #include "fractal_generator.h"
+#include "allocation_counter.h"
+
+// radical inverse of index in base, evenly spread over [0, 1) for any run of consecutive indices
+static float haltonValue(int index, int base)
+{
+	float value = 0.0f;
+	float fraction = 1.0f;
+
+	for (; index > 0; index /= base)
+	{
+		fraction /= float(base);
+		value += fraction * float(index % base);
+	}
+
+	return value;
+}
 
 fractal_generator::fractal_generator(
 	const string &randomization_seed,
 	const shared_ptr<ogl_context> &con,
-	int num_points)
+	long long num_points) : engine(randomization_seed, num_points), sm(engine.getSettings()), pipeline(engine)
 {
-	vertex_count = num_points;
-	base_seed = randomization_seed;
+	vertex_count = engine.getVertexCount();
 
 	context = con;
-	rg.seed(base_seed);
-	color_man.seed(base_seed);
-	sm.randomize(rg);
-	generateLights();
-	setMatrices();
 	initialized = false;
 
+	GLfloat width_range[2];
+	glGetFloatv(GL_ALIASED_LINE_WIDTH_RANGE, width_range);
+	glLineWidth(GLfloat(sm.line_width) * width_range[1]);
+	glLineWidth(width_range[0]);
+
 	GLint range[2];
 	glEnable(GL_PROGRAM_POINT_SIZE);
 	glGetIntegerv(GL_ALIASED_POINT_SIZE_RANGE, range);
@@ -23,59 +38,51 @@ fractal_generator::fractal_generator(
 
 	glEnable(GL_DEPTH_CLAMP);
 	glDepthRange(0.0, 1.0);
-}
-
-void fractal_generator::bufferData(const vector<float> &vertex_data, const vector<unsigned short> &line_indices_to_buffer, const vector<unsigned short> &triangle_indices_to_buffer)
-{
-	vertex_count = (vertex_data.size() / vertex_size);
-	sm.enable_triangles = vertex_count >= 3;
-	sm.enable_lines = vertex_count >= 2;
 
-	// create/bind Vertex Array Object
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
+	refresh_generator.initialize("RefreshComputeShader.glsl");
+	accumulation.initialize("AccumulationVertexShader.glsl", "AccumulationPixelShader.glsl");
 
-	// create/bind Vertex Buffer Object
-	glGenBuffers(1, &vertices_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vertices_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertex_data.size(), &vertex_data[0], GL_STATIC_DRAW);
+	glGenBuffers(1, &dof_view_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, dof_view_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(mat4) * MAX_DOF_PASSES, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-	// stride is the total size of each vertex's attribute data (position + color + size)
-	// change this to 7 for triangle bug
-	int stride = vertex_size * sizeof(float);
+	if (!color_table.initialize())
+		sm.indexed_refresh_colors = false;
 
-	// load position data
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)0);
-
-	// load color data
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
+	// the grid is built with the same cutoff the shader attenuates with
+	context->setUniform1f("light_cutoff", LIGHT_CUTOFF);
+	if (dynamic_lights.initialize())
+		context->setUniform1i("light_grid_enabled", 1);
 
-	// load point size
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
-
-	glGenBuffers(1, &line_indices);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, line_indices);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, line_indices_to_buffer.size() * sizeof(unsigned short), &line_indices_to_buffer[0], GL_STATIC_DRAW);
-	line_index_count = line_indices_to_buffer.size();
+	if (!light_volume.initialize("IrradianceComputeShader.glsl"))
+		sm.irradiance_volume_lighting = false;
+}
 
-	glGenBuffers(1, &triangle_indices);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, triangle_indices);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, triangle_indices_to_buffer.size() * sizeof(unsigned short), &triangle_indices_to_buffer[0], GL_STATIC_DRAW);
-	triangle_index_count = triangle_indices_to_buffer.size();
+void fractal_generator::bufferData(const vertex_streams &vertex_data, const vector<unsigned int> &line_indices_to_buffer, const vector<unsigned int> &triangle_indices_to_buffer)
+{
+	vertex_count = vertex_data.size();
+	sm.enable_triangles = vertex_count >= 3;
+	sm.enable_lines = vertex_count >= 2;
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	// storage persists across generations, data is copied into the ring's next region
+	vertex_buffers.setCompact(sm.compact_vertices);
+	vertex_buffers.upload(vertex_data, line_indices_to_buffer, triangle_indices_to_buffer);
+	line_index_count = vertex_buffers.getLineIndexCount();
+	triangle_index_count = vertex_buffers.getTriangleIndexCount();
 }
 
 void fractal_generator::bufferPalette(const vector<float> &vertex_data)
 {
+	// the palette is a few dozen vertices, so its buffer is kept and simply respecified each generation
+	if (initialized)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, palette_vbo);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertex_data.size(), &vertex_data[0], GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+
 	// create/bind Vertex Array Object
 	glGenVertexArrays(1, &palette_vao);
 	glBindVertexArray(palette_vao);
@@ -83,7 +90,7 @@ void fractal_generator::bufferPalette(const vector<float> &vertex_data)
 	// create/bind Vertex Buffer Object
 	glGenBuffers(1, &palette_vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, palette_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertex_data.size(), &vertex_data[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertex_data.size(), &vertex_data[0], GL_DYNAMIC_DRAW);
 
 	// 6 floats total -> 2 for position, 4 for color
 	int stride = 6 * sizeof(float);
@@ -102,17 +109,31 @@ void fractal_generator::bufferPalette(const vector<float> &vertex_data)
 	glBindVertexArray(0);
 }
 
-void fractal_generator::bufferLightData(const vector<float> &vertex_data)
+void fractal_generator::bufferLightData(const vertex_streams &vertex_data)
 {
-	for (int i = 0; i < LIGHT_COUNT; i++)
+	const vector<long long> &light_indices = engine.getLightIndices();
+	light_positions.resize(max(light_indices.size(), size_t(LIGHT_COUNT)));
+	light_colors.resize(light_positions.size());
+
+	for (int i = 0; i < int(light_positions.size()); i++)
 	{
-		if (i < light_indices.size())
+		if (i < light_indices.size() && gpu_generated)
+		{
+			// gpu generated vertices never reach the cpu, the few light points are built here instead
+			vec4 position, color;
+			float size;
+			engine.getExternalRefreshVertex(light_indices.at(i), position, color, size);
+
+			light_positions[i] = vec4(vec3(position), 1.0f);
+			light_colors[i] = vec4(vec3(color), 1.0f);
+		}
+
+		else if (i < light_indices.size())
 		{
-			int light_index = light_indices.at(i);
-			int data_index = light_index * vertex_size;
+			long long light_index = engine.getVertexIndexOfPoint(light_indices.at(i));
 
-			vec4 light_position(vertex_data.at(data_index), vertex_data.at(data_index + 1), vertex_data.at(data_index + 2), 1.0f);
-			vec4 light_color(vertex_data.at(data_index + 4), vertex_data.at(data_index + 5), vertex_data.at(data_index + 6), 1.0f);
+			vec4 light_position(vec3(vertex_data.getPositions().at(light_index)), 1.0f);
+			vec4 light_color(vec3(vertex_data.hasIndexedColors() ? engine.getIndexedColor(light_indices.at(i)) : vertex_data.getColors().at(light_index)), 1.0f);
 
 			light_positions[i] = light_position;
 			light_colors[i] = light_color;
@@ -125,105 +146,93 @@ void fractal_generator::bufferLightData(const vector<float> &vertex_data)
 		}
 	}
 
+	// with the grid available the lights are uploaded by updateDynamicLights instead
+	if (dynamic_lights.isAvailable())
+		return;
+
 	context->setUniform4fv("light_positions", LIGHT_COUNT, light_positions[0]);
 	context->setUniform4fv("light_colors", LIGHT_COUNT, light_colors[0]);
 }
 
-void fractal_generator::drawFractal(shared_ptr<ogl_camera_flying> &camera) const
+void fractal_generator::updateDynamicLights()
 {
-	// bind target VAO
-	glBindVertexArray(VAO);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
+	bool volume_enabled = sm.irradiance_volume_lighting && light_volume.isAvailable();
+	context->setUniform1i("irradiance_volume_enabled", volume_enabled ? 1 : 0);
 
-	glBindBuffer(GL_ARRAY_BUFFER, vertices_vbo);
+	// only dynamic lighting reads the grid or the volume, and switching to it marks the uniforms stale, which rebuilds them
+	if (sm.lm != DYNAMIC_LIGHTING)
+		return;
 
-	if (dof_enabled)
+	if (volume_enabled)
 	{
-		vec3 camera_vector = glm::normalize(camera->getFocus() - camera->getPosition());
-		vec3 camera_right =  glm::normalize(glm::cross(vec3(camera_vector.x, 0.0f, camera_vector.z), vec3(0.0f, 1.0f, 0.0f)));
-		vec3 camera_up = -1.0f * glm::normalize(glm::cross(camera_vector, camera_right));
+		light_volume.update(&light_positions[0], &light_colors[0], int(light_positions.size()), sm.illumination_distance, LIGHT_CUTOFF);
+		context->setUniform3fv("irradiance_volume_min", 1, light_volume.getVolumeMin());
+		context->setUniform3fv("irradiance_volume_size", 1, light_volume.getVolumeSize());
+		return;
+	}
 
-		int geometry_passes = 0;
-		geometry_passes = int(sm.enable_triangles && sm.triangle_mode != 0) + int(sm.enable_lines && sm.line_mode != 0) + int(sm.show_points);
+	if (!dynamic_lights.isAvailable())
+		return;
 
-		float total_passes = float(dof_passes * geometry_passes);
-		bool accum_loaded = false;
+	dynamic_lights.update(&light_positions[0], &light_colors[0], int(light_positions.size()), sm.illumination_distance, LIGHT_CUTOFF);
+	context->setUniform3fv("light_grid_min", 1, dynamic_lights.getGridMin());
+	context->setUniform3fv("light_grid_cell_size", 1, dynamic_lights.getCellSize());
+}
 
-		for (int i = 0; i < dof_passes; i++)
-		{
-			vec3 bokeh = camera_right * cos((float)i * 2.0f * PI / (float)dof_passes) + camera_up * sinf((float)i * 2.0f * PI / (float)dof_passes);
-			glm::mat4 modelview = glm::lookAt(camera->getPosition() + dof_aperture * bokeh, camera->getFocus(), camera_up);
-			glm::mat4 mvp = camera->getProjectionMatrix() * modelview;
-
-			context->setUniformMatrix4fv("MVP", 1, GL_FALSE, mvp);
-
-			if (sm.show_points)
-			{
-				drawVertices();
-				glAccum(accum_loaded ? GL_ACCUM : GL_LOAD, 1.0f / total_passes);
-				accum_loaded = true;
-			}
-
-			if (sm.enable_lines && sm.line_mode != 0)
-			{
-				drawLines();
-				glAccum(accum_loaded ? GL_ACCUM : GL_LOAD, 1.0f / total_passes);
-				accum_loaded = true;
-			}
-
-			if (sm.enable_triangles && sm.triangle_mode != 0)
-			{
-				drawTriangles();
-				glAccum(accum_loaded ? GL_ACCUM : GL_LOAD, 1.0f / total_passes);
-				accum_loaded = true;
-			}
-		}
-		if (total_passes > 0.5f)
-			glAccum(GL_RETURN, 1.0f / total_passes);
-	}
+void fractal_generator::drawFractal(shared_ptr<ogl_camera_flying> &camera) const
+{
+	// bind target VAO
+	glBindVertexArray(vertex_buffers.getVAO());
+	glEnableVertexAttribArray(0);
 
-	else
+	// indexed colors are never fetched, the shader resolves them
+	if (!colors_indexed)
 	{
-		int geometry_passes = 0;
-		geometry_passes = int(sm.enable_triangles && sm.triangle_mode != 0) + int(sm.enable_lines && sm.line_mode != 0) + int(sm.show_points);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+	}
 
-		bool accum_loaded = false;
+	if (keyframes_valid)
+	{
+		glEnableVertexAttribArray(4);
 
-		if (sm.show_points)
+		if (!colors_indexed)
 		{
-			drawVertices();
-			glAccum(accum_loaded ? GL_ACCUM : GL_LOAD, 1.0f / float(geometry_passes));
-			accum_loaded = true;
+			glEnableVertexAttribArray(5);
+			glEnableVertexAttribArray(6);
 		}
+	}
 
-		if (sm.enable_lines && sm.line_mode != 0)
-		{
-			drawLines();
-			glAccum(accum_loaded ? GL_ACCUM : GL_LOAD, 1.0f / float(geometry_passes));
-			accum_loaded = true;
-		}
 
-		if (sm.enable_triangles && sm.triangle_mode != 0)
-		{
-			drawTriangles();
-			glAccum(accum_loaded ? GL_ACCUM : GL_LOAD, 1.0f / float(geometry_passes));
-			accum_loaded = true;
-		}
+	if (progressive_enabled && accumulation.isAvailable())
+		drawProgressive(camera);
+
+	else if (dof_enabled && accumulation.isAvailable())
+	{
+		// every pass is the whole scene from a point on the aperture, the image is their average
+		mat4 dof_views[MAX_DOF_PASSES];
+		for (int i = 0; i < dof_passes; i++)
+			dof_views[i] = getApertureView(camera, mat4(1.0f), i, dof_passes, vec2(0.0f));
 
-		if (geometry_passes != 0)
-			glAccum(GL_RETURN, 1.0f / float(geometry_passes));
+		accumulateViews(dof_views, dof_passes, 1.0f / float(dof_passes), false);
+		accumulation.resolve();
 	}
 
+	// points, lines and triangles are drawn over each other into the bound framebuffer, as they always composited
+	// without the accumulation shaders depth of field falls back to the focused view
+	else drawGeometry();
+
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
 	glDisableVertexAttribArray(2);
+	glDisableVertexAttribArray(4);
+	glDisableVertexAttribArray(5);
+	glDisableVertexAttribArray(6);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	if (sm.show_palette)
 	{
-		glBindVertexArray(VAO);
+		glBindVertexArray(vertex_buffers.getVAO());
 		glEnableVertexAttribArray(1);
 		glEnableVertexAttribArray(3);
 
@@ -237,496 +246,185 @@ void fractal_generator::drawFractal(shared_ptr<ogl_camera_flying> &camera) const
 	glBindVertexArray(0);
 }
 
-void fractal_generator::drawVertices() const
+mat4 fractal_generator::getApertureView(const shared_ptr<ogl_camera_flying> &camera, const mat4 &camera_mvp, int view_index, int view_count, const vec2 &pixel_jitter) const
 {
-	context->setUniform1i("geometry_type", 0);
-	glDrawArrays(GL_POINTS, 0, show_growth ? glm::clamp(vertices_to_render, 0, vertex_count) : vertex_count);
-}
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
 
-void fractal_generator::drawLines() const
-{
-	context->setUniform1i("geometry_type", 1);
-	if (sm.line_mode == GL_LINES)
-	{
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, line_indices);
-		glDrawElements(sm.line_mode, show_growth ? glm::clamp(vertices_to_render, 0, line_index_count) : line_index_count, GL_UNSIGNED_SHORT, (void*)0);
-	}
+	// a clip space translation scaled by w, which moves the projected image by whole pixels after the divide
+	vec3 jitter(pixel_jitter.x * 2.0f / float(max(viewport[2], 1)), pixel_jitter.y * 2.0f / float(max(viewport[3], 1)), 0.0f);
+	mat4 jitter_matrix = glm::translate(mat4(1.0f), jitter);
 
-	else
-	{
-		glDrawArrays(sm.line_mode, 0, show_growth ? glm::clamp(vertices_to_render, 0, vertex_count) : vertex_count);
-	}
-}
+	if (!dof_enabled)
+		return jitter_matrix * camera_mvp;
 
-void fractal_generator::drawTriangles() const
-{
-	context->setUniform1i("geometry_type", 2);
-	if (sm.triangle_mode == GL_TRIANGLES)
-	{
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, triangle_indices);
-		glDrawElements(sm.triangle_mode, show_growth ? glm::clamp(vertices_to_render, 0, triangle_index_count) : triangle_index_count, GL_UNSIGNED_SHORT, (void*)0);
-	}
+	vec3 camera_vector = glm::normalize(camera->getFocus() - camera->getPosition());
+	vec3 camera_right =  glm::normalize(glm::cross(vec3(camera_vector.x, 0.0f, camera_vector.z), vec3(0.0f, 1.0f, 0.0f)));
+	vec3 camera_up = -1.0f * glm::normalize(glm::cross(camera_vector, camera_right));
 
-	else
-	{
-		glDrawArrays(sm.triangle_mode, 0, show_growth ? glm::clamp(vertices_to_render, 0, vertex_count) : vertex_count);
-	}
+	vec3 bokeh = camera_right * cos((float)view_index * 2.0f * PI / (float)view_count) + camera_up * sinf((float)view_index * 2.0f * PI / (float)view_count);
+	glm::mat4 modelview = glm::lookAt(camera->getPosition() + dof_aperture * bokeh, camera->getFocus(), camera_up);
+	return jitter_matrix * camera->getProjectionMatrix() * modelview;
 }
 
-void fractal_generator::drawPalette() const
+fractal_generator::progressive_frame_state fractal_generator::getProgressiveState(const shared_ptr<ogl_camera_flying> &camera) const
 {
-	glBindBuffer(GL_ARRAY_BUFFER, palette_vbo);
-	glDrawArrays(GL_TRIANGLES, 0, palette_vertex_count);
+	progressive_frame_state state;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &state.framebuffer);
+	glGetIntegerv(GL_VIEWPORT, state.viewport);
+
+	// the camera only hands its mvp to the context, which leaves it in the current program
+	GLint program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	glGetUniformfv(program, glGetUniformLocation(program, "MVP"), &state.mvp[0][0]);
+
+	state.camera_position = camera->getPosition();
+	state.camera_focus = camera->getFocus();
+	state.background = context->getBackgroundColor();
+	state.display_revision = display_revision;
+	state.interpolation_state = displayed_interpolation_state;
+	state.vertices_rendered = show_growth ? vertices_to_render : -1;
+	state.dof_enabled = dof_enabled;
+	state.dof_passes = dof_passes;
+	state.dof_aperture = dof_aperture;
+	state.point_size_modifier = point_size_modifier;
+	state.line_width = sm.line_width;
+	state.fractal_scale = sm.fractal_scale;
+	state.line_mode = sm.enable_lines ? sm.line_mode : 0;
+	state.triangle_mode = sm.enable_triangles ? sm.triangle_mode : 0;
+	state.show_points = sm.show_points;
+	state.show_palette = sm.show_palette;
+	state.light_effects_transparency = sm.light_effects_transparency;
+	state.color_overrides[0] = light_color_override_index;
+	state.color_overrides[1] = line_color_override_index;
+	state.color_overrides[2] = triangle_color_override_index;
+	state.color_overrides[3] = point_color_override_index;
+
+	return state;
 }
 
-vector< pair<string, mat4> > fractal_generator::generateMatrixVector(const int &count, geometry_type &geo_type)
+bool fractal_generator::progressive_frame_state::operator==(const progressive_frame_state &other) const
 {
-	vector< pair<string, mat4> > matrix_vector;
-
-	if (rg.getRandomFloat() < sm.matrix_geometry_coefficient)
-	{
-		vector<vec4> point_sequence;
-		int matrix_geometry_index;
-		// TODO create mc exception class
-		/*if (loaded_sequences.size() > 0)
-			sm.matrix_geometry_weights[LOADED_SEQUENCE] = mc.getRandomIntInRange(0, loaded_sequences.size() * 10);*/
-
-		if (!rg.catRoll<int>(sm.matrix_geometry_weights, matrix_geometry_index))
-			throw;
-
-		float random_width = rg.getRandomFloatInRange(0.2f, 1.0f);
-		float random_height = rg.getRandomFloatInRange(0.2f, 1.0f);
-		float random_depth = rg.getRandomFloatInRange(0.2f, 1.0f);
-
-		if (matrix_geometry_index < GEOMETRY_TYPE_SIZE)
-		{
-			geometry_type gt = geometry_type(matrix_geometry_index);
-
-			float random_width = rg.getRandomFloatInRange(0.2f, 1.0f);
-			float random_height = rg.getRandomFloatInRange(0.2f, 1.0f);
-			float random_depth = rg.getRandomFloatInRange(0.2f, 1.0f);
-
-			switch (gt)
-			{
-			case CUBOID: point_sequence = gm.getCuboidVertices(random_width, random_height, random_depth); break;
-			case CUBE: point_sequence = gm.getCubeVertices(random_width); break;
-			case TETRAHEDRON: point_sequence = gm.getTetrahedronVertices(random_width); break;
-			case OCTAHEDRON: point_sequence = gm.getOctahedronVertices(random_width); break;
-			case DODECAHEDRON: point_sequence = gm.getDodecahedronVertices(random_width); break;
-			case ICOSAHEDRON: point_sequence = gm.getIcosahedronVertices(random_width); break;
-				//case LOADED_SEQUENCE: geo_type = DEFAULT_GEOMETRY_TYPE;
-			case GEOMETRY_TYPE_SIZE:
-			default: throw;
-			}
-		}
-
-		else
-		{
-			matrix_geometry_index -= (int)GEOMETRY_TYPE_SIZE;
-			ngon_type nt = ngon_type(matrix_geometry_index);
-			int side_count = (int)nt + 3;
-			point_sequence = gm.getNgonVertices(rg.getRandomFloatInRange(0.2f, 1.0f), side_count);
-		}
-
-		for (int i = 0; i < count; i++)
-		{
-			vec3 vertex(point_sequence.at(i % point_sequence.size()));
-			matrix_vector.push_back(std::pair<string, mat4>("translate (" + std::to_string(matrix_geometry_index) + ")", glm::translate(mat4(1.0f), vertex)));
-		}
-	}
-
-	else
-	{
-		geo_type = GEOMETRY_TYPE_SIZE;
-		int matrix_type;
-
-		for (int i = 0; i < count; i++)
-		{
-			short matrix_type;
-			std::map<short, unsigned int> matrix_map;
-			matrix_map[0] = sm.translate_weight;
-			matrix_map[1] = sm.rotate_weight;
-			matrix_map[2] = sm.scale_matrices ? sm.scale_weight : 0;
-
-			// TODO create mc exception class
-			if (!rg.catRoll<short>(matrix_map, matrix_type))
-				throw;
-
-			string matrix_category;
-			mat4 matrix_to_add;
-
-			switch (matrix_type)
-			{
-			case 0:
-				matrix_to_add = sm.two_dimensional ? rg.getRandomTranslation2D() : rg.getRandomTranslation();
-				matrix_category = "translate";
-				break;
-			case 1:
-				matrix_to_add = sm.two_dimensional ? rg.getRandomRotation2D() : rg.getRandomRotation();
-				matrix_category = "rotate";
-				break;
-			case 2:
-				matrix_to_add = sm.two_dimensional ? rg.getRandomScale2D() : rg.getRandomScale();
-				matrix_category = "scale";
-				break;
-			default: break;
-			}
-
-			matrix_vector.push_back(pair<string, mat4>(matrix_category, matrix_to_add));
-		}
-	}
-
-	return matrix_vector;
+	return framebuffer == other.framebuffer && std::equal(viewport, viewport + 4, other.viewport)
+		&& mvp == other.mvp && camera_position == other.camera_position && camera_focus == other.camera_focus
+		&& background == other.background && display_revision == other.display_revision
+		&& interpolation_state == other.interpolation_state && vertices_rendered == other.vertices_rendered
+		&& dof_enabled == other.dof_enabled && dof_passes == other.dof_passes && dof_aperture == other.dof_aperture
+		&& point_size_modifier == other.point_size_modifier && line_width == other.line_width && fractal_scale == other.fractal_scale
+		&& line_mode == other.line_mode && triangle_mode == other.triangle_mode && show_points == other.show_points
+		&& show_palette == other.show_palette && light_effects_transparency == other.light_effects_transparency
+		&& std::equal(color_overrides, color_overrides + 4, other.color_overrides);
 }
 
-vector<vec4> fractal_generator::generateColorVector(const vec4 &seed, color_palette palette, const int &count, color_palette &random_selection) const
+void fractal_generator::accumulateViews(const mat4 *views, int view_count, float weight, bool keep_image) const
 {
-	vector<vec4> color_set;
+	glBindBuffer(GL_UNIFORM_BUFFER, dof_view_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4) * view_count, views);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, DOF_VIEW_BINDING, dof_view_buffer);
+	context->setUniform1i("dof_instanced", 1);
 
-	color_set = color_man.generatePaletteFromSeed(seed, palette, count, random_selection);
+	// each instance draws one view into its own layer of the scene target, so a batch costs one draw per geometry type.
+	// batches are as large as the target's memory allows, which is usually every view at once
+	int batch_size = accumulation.begin(view_count, keep_image);
 
-	if (sm.randomize_alpha)
-		color_man.randomizeAlpha(color_set, sm.alpha_min, sm.alpha_max);
-
-	if (sm.randomize_lightness)
-		color_man.modifyLightness(color_set, rg.getRandomFloatInRange(0.3, 1.2f));
-
-	return color_set;
-}
-
-vector<float> fractal_generator::generateSizeVector(const int &count) const
-{
-	vector<float> size_vector;
-
-	for (int i = 0; i < count; i++)
+	for (int first_view = 0; first_view < view_count; first_view += batch_size)
 	{
-		size_vector.push_back(rg.getRandomFloatInRange(POINT_SCALE_MIN, POINT_SCALE_MAX));
+		int batch_view_count = min(batch_size, view_count - first_view);
+		context->setUniform1i("dof_first_view", first_view);
+
+		accumulation.beginPass(context->getBackgroundColor());
+		drawGeometry(batch_view_count);
+		accumulation.accumulate(weight, batch_view_count);
 	}
 
-	return size_vector;
+	context->setUniform1i("dof_instanced", 0);
 }
 
-// this method is run once and only once per fractal gen object
-void fractal_generator::setMatrices()
+void fractal_generator::drawProgressive(const shared_ptr<ogl_camera_flying> &camera) const
 {
-	generation_seed = base_seed + "_" + std::to_string(sm.generation);
-	rg.seed(generation_seed);
-	color_man.seed(generation_seed);
-
-	for (int i = 0; i < vertex_count; i++)
-	{
-		matrix_sequence_front.push_back(int(rg.getRandomFloatInRange(0.0f, float(sm.num_matrices))));
-		matrix_sequence_back.push_back(int(rg.getRandomFloatInRange(0.0f, float(sm.num_matrices))));
-	}
-
-	int random_palette_index = int(rg.getRandomFloatInRange(0.0f, float(DEFAULT_COLOR_PALETTE)));
-	sm.palette_front = color_palette(random_palette_index);
-	sm.palette_back = color_palette(random_palette_index);
-
-	//TODO add .reserve() for each vector
-	matrices_front.clear();
-	colors_front.clear();
-	sizes_front.clear();
-
-	matrices_back.clear();
-	colors_back.clear();
-	sizes_back.clear();
-
-	//front data set
-	matrices_front = generateMatrixVector(sm.num_matrices, geo_type_front);
-	seed_color_front = rg.getRandomVec4FromColorRanges(
-		0.0f, 1.0f,		// red range
-		0.0f, 1.0f,		// green range
-		0.0f, 1.0f,		// blue range
-		sm.alpha_min, sm.alpha_max		// alpha range
-		);
-	colors_front = generateColorVector(seed_color_front, sm.palette_front, sm.num_matrices, sm.random_palette_front);
-	sizes_front = generateSizeVector(sm.num_matrices);
-	
-	//back data set
-	sm.generation++;
-	generation_seed = base_seed + "_" + std::to_string(sm.generation);
-	rg.seed(generation_seed);
-	color_man.seed(generation_seed);
-	matrices_back = generateMatrixVector(sm.num_matrices, geo_type_back);
-	//std::random_shuffle(matrices_front.begin(), matrices_front.end());
-	seed_color_back = rg.getRandomVec4FromColorRanges(
-		0.0f, 1.0f,		// red range
-		0.0f, 1.0f,		// green range
-		0.0f, 1.0f,		// blue range
-		sm.alpha_min, sm.alpha_max		// alpha range
-		);
-	colors_back = generateColorVector(seed_color_back, sm.palette_back, sm.num_matrices, sm.random_palette_back);
-	sizes_back = generateSizeVector(sm.num_matrices);
-}
+	progressive_frame_state state = getProgressiveState(camera);
+	int view_count = dof_enabled ? dof_passes : 1;
 
-void fractal_generator::swapMatrices() 
-{
-	if (sm.reverse)
-		sm.generation--;
+	// any change starts over from the same image the regular path draws, which later frames refine
+	if (progressive_samples == 0 || !(state == progressive_state))
+	{
+		progressive_state = state;
 
-	else sm.generation++;
+		mat4 views[MAX_DOF_PASSES];
+		for (int i = 0; i < view_count; i++)
+			views[i] = getApertureView(camera, state.mvp, i, view_count, vec2(0.0f));
 
-	generation_seed = base_seed + "_" + std::to_string(sm.generation);
-	rg.seed(generation_seed);
+		accumulateViews(views, view_count, 1.0f, false);
+		progressive_samples = view_count;
+	}
 
-	//TODO use pointers instead of loaded if statements
-	if (!sm.reverse)
+	// each round through the aperture views is offset by a different fraction of a pixel, which antialiases the image
+	else if (progressive_samples < MAX_PROGRESSIVE_SAMPLES)
 	{
-		matrices_back = matrices_front;
-		vector<unsigned int> matrix_sequence_temp(matrix_sequence_back);
-		matrix_sequence_back = matrix_sequence_front;
-		matrix_sequence_front = matrix_sequence_temp;
-		colors_back = colors_front;
-		sizes_back = sizes_front;
-		seed_color_back = seed_color_front;
-		sm.background_back_index = sm.background_front_index;
-		sm.background_front_index = rg.getRandomIntInRange(0, colors_front.size());
-
-		seed_color_front = rg.getRandomVec4FromColorRanges(
-			0.0f, 1.0f,		// red range
-			0.0f, 1.0f,		// green range
-			0.0f, 1.0f,		// blue range
-			sm.alpha_min, sm.alpha_max		// alpha range
-			);
+		int round = progressive_samples / view_count;
+		vec2 jitter(haltonValue(round, 2) - 0.5f, haltonValue(round, 3) - 0.5f);
+		mat4 view = getApertureView(camera, state.mvp, progressive_samples % view_count, view_count, jitter);
 
-		matrices_front = generateMatrixVector(matrices_back.size(), geo_type_front);
-		colors_front = generateColorVector(seed_color_front, sm.palette_front, matrices_back.size(), sm.random_palette_front);
-		sizes_front = generateSizeVector(matrices_back.size());
+		accumulateViews(&view, 1, 1.0f, true);
+		progressive_samples++;
 	}
 
-	else
-	{
-		matrices_front = matrices_back;
-		vector<unsigned int> matrix_sequence_temp(matrix_sequence_front);
-		matrix_sequence_front = matrix_sequence_back;
-		matrix_sequence_back = matrix_sequence_temp;
-		colors_front = colors_back;
-		sizes_front = sizes_back;
-		seed_color_front = seed_color_back;
-		sm.background_front_index = sm.background_back_index;
-		sm.background_back_index = rg.getRandomIntInRange(0, colors_back.size());
-
-		seed_color_back = rg.getRandomVec4FromColorRanges(
-			0.0f, 1.0f,		// red range
-			0.0f, 1.0f,		// green range
-			0.0f, 1.0f,		// blue range
-			sm.alpha_min, sm.alpha_max		// alpha range
-			);
-
-		matrices_back = generateMatrixVector(matrices_front.size(), geo_type_back);
-		colors_back = generateColorVector(seed_color_back, sm.palette_back, matrices_front.size(), sm.random_palette_back);
-		sizes_back = generateSizeVector(matrices_front.size());
-	}
-
-	if (sm.print_context_on_swap)
-		printContext();
+	accumulation.resolve(1.0f / float(progressive_samples));
 }
 
-void fractal_generator::cycleColorPalette()
+void fractal_generator::drawGeometry(GLsizei instance_count) const
 {
-	// palettes separated in case these change independently at some point
-	if (sm.palette_front == DEFAULT_COLOR_PALETTE)
-		sm.palette_front = color_palette(0);
+	if (sm.show_points)
+		drawVertices(instance_count);
 
-	else sm.palette_front = color_palette(int(sm.palette_front) + 1);
+	if (sm.enable_lines && sm.line_mode != 0)
+		drawLines(instance_count);
 
-	if (sm.palette_back == DEFAULT_COLOR_PALETTE)
-		sm.palette_back = color_palette(0);
-
-	else sm.palette_back = color_palette(int(sm.palette_back) + 1);
+	if (sm.enable_triangles && sm.triangle_mode != 0)
+		drawTriangles(instance_count);
 }
 
-void fractal_generator::printMatrices() const
+void fractal_generator::drawVertices(GLsizei instance_count) const
 {
-	cout << "-----matrices_front-----" << endl;
-	for (const auto &matrix_pair : matrices_front)
-	{
-		cout << matrix_pair.first << endl;
-		cout << glm::to_string(matrix_pair.second) << endl;
-		cout << "----------" << endl;
-	}
-
-	cout << "-----matrices_back-----" << endl;
-	for (const auto &matrix_pair : matrices_back)
-	{
-		cout << matrix_pair.first << endl;
-		cout << glm::to_string(matrix_pair.second) << endl;
-		cout << "----------" << endl;
-	}
-
-	cout << "------------------" << endl;
+	context->setUniform1i("geometry_type", 0);
+	vertex_buffers.drawArrays(GL_POINTS, show_growth ? glm::clamp<long long>(vertices_to_render, 0, vertex_count) : vertex_count, instance_count);
 }
 
-void fractal_generator::generateFractalFromPointSequence()
+void fractal_generator::drawLines(GLsizei instance_count) const
 {
-	vector<float> points;
-	vector<unsigned short> line_indices_to_buffer;
-	vector<unsigned short> triangle_indices_to_buffer;
-	points.reserve(vertex_count * vertex_size);
-
-	int num_matrices = matrices_front.size();
-
-	vec4 point_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
-	float starting_size = POINT_SCALE_MAX;
-
-	mat4 origin_matrix = glm::scale(mat4(1.0f), vec3(1.0f, 1.0f, 1.0f));
-
-	int current_sequence_index_lines = 0;
-	int current_sequence_index_triangles = 0;
-
-	for (int i = 0; i < vertex_count / sm.point_sequence.size(); i++)
+	context->setUniform1i("geometry_type", 1);
+	// deduplicated vertex data is only in point order through the index buffers
+	if (!gpu_generated && (sm.line_mode == GL_LINES || engine.isDeduplicated()))
 	{
-		int matrix_index_front = sm.smooth_render ? matrix_sequence_front.at(i) : int(rg.getRandomFloatInRange(0.0f, float(matrices_front.size())));
-		int matrix_index_back = sm.smooth_render ? matrix_sequence_back.at(i) : int(rg.getRandomFloatInRange(0.0f, float(matrices_front.size())));
-		vec4 transformation_color = influenceElement<vec4>(colors_back.at(matrix_index_back), colors_front.at(matrix_index_front), sm.interpolation_state);
-		float transformation_size = influenceElement<float>(sizes_back.at(matrix_index_back), sizes_front.at(matrix_index_front), sm.interpolation_state);
-
-		addPointSequenceAndIterate(origin_matrix, point_color, starting_size, matrix_index_front, matrix_index_back, points, line_indices_to_buffer, triangle_indices_to_buffer, current_sequence_index_lines, current_sequence_index_triangles);
+		vertex_buffers.drawLineElements(sm.line_mode, show_growth ? glm::clamp<long long>(vertices_to_render, 0, line_index_count) : line_index_count, instance_count);
 	}
 
-	addPalettePointsAndBufferData(points, line_indices_to_buffer, triangle_indices_to_buffer);
-}
-
-void fractal_generator::generateFractal()
-{
-	vector<float> points;
-	vector<unsigned short> line_indices_to_buffer;
-	vector<unsigned short> triangle_indices_to_buffer;
-	points.reserve(vertex_count * vertex_size);
-
-	int num_matrices = matrices_front.size();
-
-	vec4 starting_point = origin;
-	vec4 point_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
-	float starting_size = POINT_SCALE_MAX;
-
-	for (int i = 0; i < vertex_count && num_matrices > 0; i++)
+	else
 	{
-		int matrix_index_front = sm.smooth_render ? matrix_sequence_front.at(i) : int(rg.getRandomFloatInRange(0.0f, float(matrices_front.size())));
-		int matrix_index_back = sm.smooth_render ? matrix_sequence_back.at(i) : int(rg.getRandomFloatInRange(0.0f, float(matrices_front.size())));
-
-		addNewPointAndIterate(starting_point, point_color, starting_size, matrix_index_front, matrix_index_back, points);
-		line_indices_to_buffer.push_back(line_indices_to_buffer.size());
-		triangle_indices_to_buffer.push_back(triangle_indices_to_buffer.size());
+		vertex_buffers.drawArrays(sm.line_mode, show_growth ? glm::clamp<long long>(vertices_to_render, 0, vertex_count) : vertex_count, instance_count);
 	}
-
-	addPalettePointsAndBufferData(points, line_indices_to_buffer, triangle_indices_to_buffer);
 }
 
-void fractal_generator::generateFractalWithRefresh()
+void fractal_generator::drawTriangles(GLsizei instance_count) const
 {
-	vector<float> points;
-	vector<unsigned short> line_indices_to_buffer;
-	vector<unsigned short> triangle_indices_to_buffer;
-	points.reserve(vertex_count * vertex_size);
-
-	int num_matrices = matrices_front.size();
-	signed int actual_refresh = sm.refresh_value == -1 ? int(rg.getRandomFloatInRange(sm.refresh_min, sm.refresh_max)) : sm.refresh_value;
-
-	for (int i = 0; i < vertex_count && num_matrices > 0; i++)
+	context->setUniform1i("geometry_type", 2);
+	if (!gpu_generated && (sm.triangle_mode == GL_TRIANGLES || engine.isDeduplicated()))
 	{
-		vec4 point_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
-		vec4 new_point = origin;
-		float new_size = POINT_SCALE_MAX;
-
-		for (int n = 0; n < actual_refresh; n++)
-		{
-			int matrix_index_front = sm.smooth_render ? matrix_sequence_front.at((i + n) % matrix_sequence_front.size()) : int(rg.getRandomFloatInRange(0.0f, float(matrices_front.size())));
-			int matrix_index_back = sm.smooth_render ? matrix_sequence_back.at((i + n) % matrix_sequence_back.size()) : int(rg.getRandomFloatInRange(0.0f, float(matrices_back.size())));
-
-			mat4 matrix_front = matrices_front.at(matrix_index_front).second;
-			mat4 matrix_back = matrices_back.at(matrix_index_back).second;
-			vec4 point_front = matrix_front * new_point;
-			vec4 point_back = matrix_back * new_point;
-
-			sm.interpolation_state = glm::clamp(sm.interpolation_state, 0.0f, 1.0f);
-
-			vec4 transformation_color = influenceElement<vec4>(colors_back.at(matrix_index_back), colors_front.at(matrix_index_front), sm.interpolation_state);
-			float transformation_size = influenceElement<float>(sizes_back.at(matrix_index_back), sizes_front.at(matrix_index_front), sm.interpolation_state);
-			new_point = influenceElement<vec4>(point_back, point_front, sm.interpolation_state);
-
-			point_color += transformation_color;
-    			new_size += transformation_size;
-		}
-
-		point_color /= ((float)actual_refresh + 1.0f);
-		new_size /= ((float)actual_refresh + 1.0f);
-
-		addNewPoint(new_point, point_color, new_size, points);
-		line_indices_to_buffer.push_back(line_indices_to_buffer.size());
-		triangle_indices_to_buffer.push_back(triangle_indices_to_buffer.size());
+		vertex_buffers.drawTriangleElements(sm.triangle_mode, show_growth ? glm::clamp<long long>(vertices_to_render, 0, triangle_index_count) : triangle_index_count, instance_count);
 	}
 
-	addPalettePointsAndBufferData(points, line_indices_to_buffer, triangle_indices_to_buffer);
-}
-
-void fractal_generator::generateFractalFromPointSequenceWithRefresh()
-{
-	vector<float> points;
-	vector<unsigned short> line_indices_to_buffer;
-	vector<unsigned short> triangle_indices_to_buffer;
-	points.reserve(vertex_count * vertex_size);
-
-	int num_matrices = matrices_front.size();
-
-	signed int actual_refresh = sm.refresh_value == -1 ? int(rg.getRandomFloatInRange(sm.refresh_min, sm.refresh_max)) : sm.refresh_value;
-
-	int current_sequence_index_lines = 0;
-	int current_sequence_index_triangles = 0;
-
-	for (int i = 0; i < vertex_count / sm.point_sequence.size() && num_matrices > 0; i++)
+	else
 	{
-		vec4 final_color = sm.inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
-		float final_size = POINT_SCALE_MAX;
-		mat4 final_matrix = glm::scale(mat4(1.0f), vec3(1.0f, 1.0f, 1.0f));
-
-		for (int n = 0; n < actual_refresh; n++)
-		{
-			int matrix_index_front = sm.smooth_render ? matrix_sequence_front.at((i + n) % matrix_sequence_front.size()) : int(rg.getRandomFloatInRange(0.0f, float(matrices_front.size())));
-			int matrix_index_back = sm.smooth_render ? matrix_sequence_back.at((i + n) % matrix_sequence_back.size()) : int(rg.getRandomFloatInRange(0.0f, float(matrices_back.size())));
-
-			mat4 matrix_front = matrices_front.at(matrix_index_front).second;
-			mat4 matrix_back = matrices_back.at(matrix_index_back).second;
-			mat4 interpolated_matrix = influenceElement<mat4>(matrix_back, matrix_front, sm.interpolation_state);
-			vec4 transformation_color = influenceElement<vec4>(colors_back.at(matrix_index_back), colors_front.at(matrix_index_front), sm.interpolation_state);
-			float transformation_size = influenceElement<float>(sizes_back.at(matrix_index_back), sizes_front.at(matrix_index_front), sm.interpolation_state);
-
-			final_matrix = interpolated_matrix * final_matrix;
-			final_color += transformation_color;
-			final_size += transformation_size;
-		}
-
-		final_color /= float(actual_refresh + 1);
-		final_size /= float(actual_refresh + 1);
-
-		int index_sequences_added = points.size() / (sm.point_sequence.size() * vertex_size);
-
-		// determine where values should begin based on the used sequence and number of indices already added
-
-		vector<int>::iterator max_local_value_lines = std::max_element(sm.line_indices.begin(), sm.line_indices.end());
-		int starting_index_lines = index_sequences_added * (*max_local_value_lines + 1);
-		for (const unsigned short index : sm.line_indices)
-		{
-			line_indices_to_buffer.push_back(starting_index_lines + index);
-		}
-
-		vector<int>::iterator max_local_value_triangles = std::max_element(sm.triangle_indices.begin(), sm.triangle_indices.end());
-		int starting_index_triangles = index_sequences_added * (*max_local_value_triangles + 1);
-		for (const unsigned short index : sm.triangle_indices)
-		{
-			triangle_indices_to_buffer.push_back(starting_index_triangles + index);
-		}
-
-		for (int n = 0; n < sm.point_sequence.size(); n++)
-		{
-			addNewPoint(final_matrix * sm.point_sequence.at(n), final_color, final_size, points);
-		}
+		vertex_buffers.drawArrays(sm.triangle_mode, show_growth ? glm::clamp<long long>(vertices_to_render, 0, vertex_count) : vertex_count, instance_count);
 	}
-
-	addPalettePointsAndBufferData(points, line_indices_to_buffer, triangle_indices_to_buffer);
 }
 
+void fractal_generator::drawPalette() const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, palette_vbo);
+	glDrawArrays(GL_TRIANGLES, 0, palette_vertex_count);
+}
 
 void fractal_generator::renderFractal(const int &image_width, const int &image_height, const int &matrix_sequence_count)
 {
@@ -757,7 +455,7 @@ void fractal_generator::renderFractal(const int &image_width, const int &image_h
 
 	fScreenshot = fopen(cFileName, "wb");
 
-	vector<mat4> matrix_sequence = generateMatrixSequence(10);
+	vector<mat4> matrix_sequence = engine.generateMatrixSequence(10);
 	map<int, int> calc_map;
 	vec4 white(1.0f, 1.0f, 1.0f, 1.0f);
 	mat4 scale_matrix = glm::scale(mat4(1.0f), vec3(1.0f, 1.0f, 1.0f));
@@ -818,253 +516,16 @@ void fractal_generator::renderFractal(const int &image_width, const int &image_h
 	return;
 }
 
-vector<mat4> fractal_generator::generateMatrixSequence(const int &sequence_size) const
-{
-	vector<mat4> matrix_sequence;
-
-	for (int i = 0; i < sequence_size; i++)
-	{
-		int random_index = rg.getRandomUniform() * (float)matrices_front.size();
-		matrix_sequence.push_back(matrices_front.at(random_index).second);
-	}
-
-	//return matrix_sequence;
-
-	vector<mat4> dummy_sequence = {
-		glm::translate(mat4(1.0f), vec3(0.01f, 0.01f, 0.0f)),
-		glm::rotate(mat4(1.0f), 0.05f, vec3(0.0f, 0.0f, 1.0f)),
-		glm::translate(mat4(1.0f), vec3(0.02f, -0.01f, 0.0f)),
-		glm::translate(mat4(1.0f), vec3(-0.01f, 0.02f, 0.0f)),
-		glm::rotate(mat4(1.0f), 0.02f, vec3(0.0f, 0.0f, 1.0f))
-	};
-
-	return dummy_sequence;
-}
-
-void fractal_generator::addNewPointAndIterate(
-	vec4 &starting_point,
-	vec4 &starting_color,
-	float &starting_size,
-	int matrix_index_front,
-	int matrix_index_back,
-	vector<float> &points)
-{
-	mat4 matrix_front = matrices_front.at(matrix_index_front).second;
-	mat4 matrix_back = matrices_back.at(matrix_index_back).second;
-	vec4 point_front = matrix_front * starting_point;
-	vec4 point_back = matrix_back * starting_point;
-
-	vec4 matrix_color_front = influenceElement<vec4>(starting_color, colors_front.at(matrix_index_front), sm.bias_coefficient);
-	vec4 matrix_color_back = influenceElement<vec4>(starting_color, colors_back.at(matrix_index_back), sm.bias_coefficient);
-
-	float point_size_front = influenceElement<float>(starting_size, sizes_front.at(matrix_index_front), sm.bias_coefficient);
-	float point_size_back = influenceElement<float>(starting_size, sizes_back.at(matrix_index_back), sm.bias_coefficient);
-
-	starting_point = influenceElement<vec4>(point_back, point_front, sm.interpolation_state);
-	starting_color = influenceElement<vec4>(matrix_color_back, matrix_color_front, sm.interpolation_state);
-	starting_size = influenceElement<float>(point_size_back, point_size_front, sm.interpolation_state);
-
-	vec4 point_to_add = starting_point;
-
-	if (points.size() == 0)
-	{
-		focal_point = vec3(0.0f);
-		average_delta = 0.0f;
-		max_x = 0.0f;
-		max_y = 0.0f;
-		max_z = 0.0f;
-	}
-
-	float current_point_count = points.size();
-
-	focal_point = ((current_point_count * focal_point) + vec3(point_to_add)) / (current_point_count + 1.0f);
-	float delta = glm::length(vec3(point_to_add) - focal_point);
-	average_delta = ((current_point_count * average_delta) + delta) / (current_point_count + 1.0f);
-
-	if (point_to_add.x > max_x)
-		max_x = point_to_add.x;
-
-	if (point_to_add.y > max_y)
-		max_y = point_to_add.y;
-
-	if (point_to_add.z > max_z)
-		max_z = point_to_add.z;
-
-	points.push_back((float)(point_to_add.x));
-	points.push_back((float)(point_to_add.y));
-	points.push_back((float)(point_to_add.z));
-	points.push_back((float)(starting_point.w));
-
-	points.push_back((float)(starting_color.r));
-	points.push_back((float)(starting_color.g));
-	points.push_back((float)(starting_color.b));
-	points.push_back((float)(starting_color.a));
-	points.push_back(starting_size);
-}
-
-void fractal_generator::addPointSequenceAndIterate(
-	mat4 &origin_matrix,
-	vec4 &starting_color,
-	float &starting_size,
-	int matrix_index_front,
-	int matrix_index_back,
-	vector<float> &points,
-	vector<unsigned short> &line_indices,
-	vector<unsigned short> &triangle_indices,
-	int &current_sequence_index_lines,
-	int &current_sequence_index_triangles)
-{
-	mat4 matrix_front = matrices_front.at(matrix_index_front).second;
-	mat4 matrix_back = matrices_back.at(matrix_index_back).second;
-	mat4 interpolated_matrix = influenceElement<mat4>(matrix_back, matrix_front, sm.interpolation_state);
-	mat4 final_matrix = interpolated_matrix * origin_matrix;
-
-	vec4 matrix_color_front = influenceElement<vec4>(starting_color, colors_front.at(matrix_index_front), sm.bias_coefficient);
-	vec4 matrix_color_back = influenceElement<vec4>(starting_color, colors_back.at(matrix_index_back), sm.bias_coefficient);
-
-	float point_size_front = influenceElement<float>(starting_size, sizes_front.at(matrix_index_front), sm.bias_coefficient);
-	float point_size_back = influenceElement<float>(starting_size, sizes_back.at(matrix_index_back), sm.bias_coefficient);
-
-	starting_color = influenceElement<vec4>(matrix_color_back, matrix_color_front, sm.interpolation_state);
-	starting_size = influenceElement<float>(point_size_back, point_size_front, sm.interpolation_state);
-
-	for (const vec4 &point : sm.point_sequence)
-	{
-		vec4 point_to_add = final_matrix * point;
-
-		if (points.size() == 0)
-		{
-			focal_point = vec3(0.0f);
-			average_delta = 0.0f;
-			max_x = 0.0f;
-			max_y = 0.0f;
-			max_z = 0.0f;
-		}
-
-		float current_point_count = points.size();
-
-		focal_point = ((current_point_count * focal_point) + vec3(point_to_add)) / (current_point_count + 1.0f);
-		float delta = glm::length(vec3(point_to_add) - focal_point);
-		average_delta = ((current_point_count * average_delta) + delta) / (current_point_count + 1.0f);
-
-		if (point_to_add.x > max_x)
-			max_x = point_to_add.x;
-
-		if (point_to_add.y > max_y)
-			max_y = point_to_add.y;
-
-		if (point_to_add.z > max_z)
-			max_z = point_to_add.z;
-
-		points.push_back((float)(point_to_add.x));
-		points.push_back((float)(point_to_add.y));
-		points.push_back((float)(point_to_add.z));
-		points.push_back((float)(1.0f));
-
-		points.push_back((float)(starting_color.r));
-		points.push_back((float)(starting_color.g));
-		points.push_back((float)(starting_color.b));
-		points.push_back((float)(starting_color.a));
-		points.push_back(starting_size);
-	}	
-
-	int local_points_size = sm.point_sequence.size();
-	int index_sequences_added = points.size() / (sm.point_sequence.size() * vertex_size);
-
-	// determine where values should begin based on the used sequence and number of indices already added
-	vector<int>::iterator max_local_value_lines = std::max_element(sm.line_indices.begin(), sm.line_indices.end());
-	int starting_index_lines = current_sequence_index_lines;
-	for (const unsigned short index : sm.line_indices)
-	{
-		line_indices.push_back(starting_index_lines + index);
-	}
-
-	current_sequence_index_lines += *max_local_value_lines;
-
-	vector<int>::iterator max_local_value_triangles = std::max_element(sm.triangle_indices.begin(), sm.triangle_indices.end());
-	int starting_index_triangles = current_sequence_index_triangles;
-	for (const unsigned short index : sm.triangle_indices)
-	{
-		triangle_indices.push_back(starting_index_triangles + index);
-	}
-
-	current_sequence_index_triangles += *max_local_value_triangles;
-
-	origin_matrix = final_matrix;
-}
-
-void fractal_generator::addNewPoint(
-	const vec4 &point,
-	const vec4 &color,
-	const float &size,
-	vector<float> &points)
-{
-	vec4 point_to_add = point;
-
-	if (points.size() == 0)
-	{
-		focal_point = vec3(0.0f);
-		average_delta = 0.0f;
-		max_x = 0.0f;
-		max_y = 0.0f;
-		max_z = 0.0f;
-	}
-
-	float current_point_count = points.size();
-
-	focal_point = ((current_point_count * focal_point) + vec3(point_to_add)) / (current_point_count + 1.0f);
-	float delta = glm::length(vec3(point_to_add) - focal_point);
-	average_delta = ((current_point_count * average_delta) + delta) / (current_point_count + 1.0f);
-
-	if (point_to_add.x > max_x)
-		max_x = point_to_add.x;
-
-	if (point_to_add.y > max_y)
-		max_y = point_to_add.y;
-
-	if (point_to_add.z > max_z)
-		max_z = point_to_add.z;
-
-	points.push_back((float)point_to_add.x);
-	points.push_back((float)point_to_add.y);
-	points.push_back((float)point_to_add.z);
-	points.push_back((float)point.w);
-
-	points.push_back((float)color.r);
-	points.push_back((float)color.g);
-	points.push_back((float)color.b);
-	points.push_back((float)color.a);
-	points.push_back(size);
-}
-
-vec4 fractal_generator::getSampleColor(const int &samples, const vector<vec4> &color_pool) const
-{
-	if (samples > color_pool.size())
-	{
-		cout << "color samples requested are greater than the number of colors in the targeted generator" << endl;
-		return vec4(0.0f, 0.0f, 0.0f, 1.0f);
-	}
-
-	vec4 out_color(0.0f, 0.0f, 0.0f, 0.0f);
-
-	if (samples <= 0)
-		return out_color;
-
-	for (int i = 0; i < samples; i++)
-	{
-		int random_index = (int)(rg.getRandomUniform() * color_pool.size());
-		out_color += color_pool.at(random_index);
-	}
-
-	out_color /= (float)samples;
-	return out_color;
-}
-
 void fractal_generator::checkKeys(const shared_ptr<key_handler> &keys)
 {
+	// keys change engine state, which a paused animation may still be generating from
+	finishPendingFrame();
+
 	if (keys->checkPress(GLFW_KEY_O, false))
 	{
-		//available
+		progressive_enabled = !progressive_enabled;
+		progressive_samples = 0;
+		progressive_enabled ? cout << "progressive accumulation enabled" << endl : cout << "progressive accumulation disabled" << endl;
 	}
 
 	if (keys->checkPress(GLFW_KEY_J, false))
@@ -1085,13 +546,13 @@ void fractal_generator::checkKeys(const shared_ptr<key_handler> &keys)
 
 	if (keys->checkPress(GLFW_KEY_HOME, false) && keys->checkShiftHold())
 	{
-		dof_passes = glm::clamp(dof_passes + 1, 1, 50);
+		dof_passes = glm::clamp(dof_passes + 1, 1, MAX_DOF_PASSES);
 		cout << "dof_passes: " << dof_passes << endl;
 	}
 
 	if (keys->checkPress(GLFW_KEY_END, false) && keys->checkShiftHold())
 	{
-		dof_passes = glm::clamp(dof_passes - 1, 1, 50);
+		dof_passes = glm::clamp(dof_passes - 1, 1, MAX_DOF_PASSES);
 		cout << "dof_passes: " << dof_passes << endl;
 	}
 
@@ -1165,7 +626,10 @@ void fractal_generator::checkKeys(const shared_ptr<key_handler> &keys)
 	}
 
 	if (keys->checkPress(GLFW_KEY_3, false))
-		cycleGeometryType();
+	{
+		engine.cycleGeometryType();
+		invalidate(INVALIDATE_VERTICES);
+	}
 
 	if (keys->checkPress(GLFW_KEY_4, false))
 	{
@@ -1245,16 +709,20 @@ void fractal_generator::checkKeys(const shared_ptr<key_handler> &keys)
 		invertColors();
 
 	if (keys->checkPress(GLFW_KEY_N, false))
-		regenerateFractal();
+		invalidate(INVALIDATE_ALL);
 
 	if (keys->checkPress(GLFW_KEY_Z, false))
+	{
 		sm.smooth_render = !sm.smooth_render;
+		invalidate(INVALIDATE_VERTICES);
+	}
 
 	if (keys->checkPress(GLFW_KEY_Y, false))
 	{
-		cycleColorPalette();
-		cout << "front palette: " + color_man.getPaletteName(sm.palette_front) << endl;
-		cout << "back palette: " + color_man.getPaletteName(sm.palette_back) << endl;
+		// the new palettes are drawn from at the next newColors or matrix swap, nothing generated changes yet
+		engine.cycleColorPalette();
+		cout << "front palette: " + engine.getColorManager().getPaletteName(sm.palette_front) << endl;
+		cout << "back palette: " + engine.getColorManager().getPaletteName(sm.palette_back) << endl;
 	}
 
 	if (keys->checkPress(GLFW_KEY_SEMICOLON, false))
@@ -1281,7 +749,7 @@ void fractal_generator::checkKeys(const shared_ptr<key_handler> &keys)
 
 			else sm.illumination_distance = glm::clamp(sm.illumination_distance - 0.01f, 0.01f, 10.0f);
 
-			context->setUniform1f("illumination_distance", sm.lm == CAMERA ? sm.illumination_distance * 10.0f : sm.illumination_distance);
+			invalidate(INVALIDATE_UNIFORMS);
 		}
 
 		else
@@ -1310,20 +778,25 @@ void fractal_generator::checkKeys(const shared_ptr<key_handler> &keys)
 
 		cout << "lighting mode: " << getStringFromLightingMode(sm.lm) << endl;
 
-		context->setUniform1i("lighting_mode", int(sm.lm));
-		context->setUniform1i("illumination_distance", sm.lm == CAMERA ? sm.illumination_distance * 10.0f : sm.illumination_distance);
+		invalidate(INVALIDATE_UNIFORMS);
 	}
 
 	if (sm.refresh_value != -1 && keys->checkPress(GLFW_KEY_6, false))
 	{
 		sm.refresh_value == sm.refresh_min ? sm.refresh_value = -1 : sm.refresh_value--;
 		cout << "refresh value: " << sm.refresh_value << endl;
+
+		if (sm.refresh_enabled)
+			invalidate(INVALIDATE_VERTICES);
 	}
 
 	if (sm.refresh_value != sm.refresh_max && keys->checkPress(GLFW_KEY_7, false))
 	{
 		sm.refresh_value == -1 ? sm.refresh_value = sm.refresh_min : sm.refresh_value++;
 		cout << "refresh value: " << sm.refresh_value << endl;
+
+		if (sm.refresh_enabled)
+			invalidate(INVALIDATE_VERTICES);
 	}
 
 	if (keys->checkPress(GLFW_KEY_MINUS, false))
@@ -1333,32 +806,56 @@ void fractal_generator::checkKeys(const shared_ptr<key_handler> &keys)
 	}
 
 	if (keys->checkPress(GLFW_KEY_EQUAL, false))
+	{
 		sm.refresh_enabled = !sm.refresh_enabled;
+		invalidate(INVALIDATE_VERTICES);
+	}
 
 	if (keys->checkPress(GLFW_KEY_F12, false))
 		dof_enabled = !dof_enabled;
-}
 
-void fractal_generator::tickAnimation() {
-	float increment_coefficient = 1.0f - (abs(0.5f - sm.interpolation_state) * 2.0f);
+	if (keys->checkPress(GLFW_KEY_F10, false))
+	{
+		sm.compact_vertices = !sm.compact_vertices;
+		sm.compact_vertices ? cout << "compact vertices enabled" << endl : cout << "compact vertices disabled" << endl;
+		invalidate(INVALIDATE_VERTICES);
+	}
 
-	float actual_increment = glm::clamp(sm.interpolation_increment * increment_coefficient * increment_coefficient, sm.interpolation_increment * 0.05f, sm.interpolation_increment);
+	if (keys->checkPress(GLFW_KEY_F11, false))
+	{
+		sm.keyframe_animation = !sm.keyframe_animation;
+		sm.keyframe_animation ? cout << "keyframe animation enabled" << endl : cout << "keyframe animation disabled" << endl;
+	}
 
-	sm.reverse ? sm.interpolation_state -= actual_increment : sm.interpolation_state += actual_increment;
+	if (keys->checkPress(GLFW_KEY_F9, false) && light_volume.isAvailable())
+	{
+		sm.irradiance_volume_lighting = !sm.irradiance_volume_lighting;
+		sm.irradiance_volume_lighting ? cout << "irradiance volume lighting enabled" << endl : cout << "irradiance volume lighting disabled" << endl;
+		invalidate(INVALIDATE_UNIFORMS);
+	}
+}
 
-	if (sm.interpolation_state <= 0.0f)
+void fractal_generator::tickAnimation(bool exact) {
+	if (!exact && canBlendKeyframes())
 	{
-		sm.interpolation_state = 1.0f;
-		swapMatrices();
+		// the engine has to be back on this thread before keyframes are generated from it
+		finishPendingFrame();
+		tickKeyframes();
 	}
 
-	else if (sm.interpolation_state >= 1.0f)
+	// a frame begun by beginNextFrame has already been advanced and generated on the worker
+	else if (pipeline.getOutstandingCount() > 0)
+		finishPendingFrame();
+
+	// every vertex attribute and the palette swatches are interpolated
+	else
 	{
-		sm.interpolation_state = 0.0f;
-		swapMatrices();
+		engine.tickInterpolation();
+		invalidate(INVALIDATE_VERTICES | INVALIDATE_PALETTE);
 	}
 
-	regenerateFractal();
+	updateInvalidatedState();
+
 	updateBackground();
 
 	if (show_growth)
@@ -1382,8 +879,8 @@ void fractal_generator::updateBackground()
 
 	else
 	{
-		vec4 new_background = influenceElement<vec4>(colors_back.at(sm.background_back_index), colors_front.at(sm.background_front_index), sm.interpolation_state);
-		color_man.adjustLightness(new_background, 0.1f);
+		vec4 new_background = influenceElement<vec4>(getColorsBack().at(sm.background_back_index), getColorsFront().at(sm.background_front_index), sm.interpolation_state);
+		engine.getColorManager().adjustLightness(new_background, 0.1f);
 
 		if (sm.inverted)
 			new_background = vec4(1.0f) - new_background;
@@ -1400,57 +897,231 @@ void fractal_generator::invertColors()
 	sm.inverted = !sm.inverted;
 	context->setUniform1i("invert_colors", sm.inverted ? 1 : 0);
 	updateBackground();
+
+	// refresh points start from white or black depending on inversion
+	invalidate(INVALIDATE_COLORS);
 }
 
 void fractal_generator::newColors()
 {
-	seed_color_front = rg.getRandomVec4FromColorRanges(
-		0.0f, 1.0f,		// red range
-		0.0f, 1.0f,		// green range
-		0.0f, 1.0f,		// blue range
-		sm.alpha_min, sm.alpha_max		// alpha range
-		);
-
-	seed_color_back = rg.getRandomVec4FromColorRanges(
-		0.0f, 1.0f,		// red range
-		0.0f, 1.0f,		// green range
-		0.0f, 1.0f,		// blue range
-		sm.alpha_min, sm.alpha_max		// alpha range
-		);
-
-	colors_front = generateColorVector(seed_color_front, sm.palette_front, matrices_front.size(), sm.random_palette_front);
-	colors_back = generateColorVector(seed_color_back, sm.palette_back, matrices_front.size(), sm.random_palette_back);
-
+	engine.newColors();
 	updateBackground();
+	invalidate(INVALIDATE_COLORS | INVALIDATE_PALETTE);
 }
 
 void fractal_generator::regenerateFractal()
 {
-	if (sm.refresh_enabled)
+	invalidate(INVALIDATE_ALL);
+	updateInvalidatedState();
+}
+
+void fractal_generator::invalidate(unsigned int domains)
+{
+	// lights are sampled from generated vertices
+	if (domains & (INVALIDATE_POSITIONS | INVALIDATE_COLORS))
+		domains |= INVALIDATE_LIGHTS;
+
+	invalidated_domains |= domains;
+	display_revision++;
+}
+
+void fractal_generator::updateInvalidatedState()
+{
+	if (invalidated_domains & INVALIDATE_POSITIONS)
+		generateVertices();
+
+	// positions stay resident on the gpu when only colors or sizes changed
+	else if (invalidated_domains & (INVALIDATE_COLORS | INVALIDATE_SIZES))
+		generateColors();
+
+	if (invalidated_domains & INVALIDATE_LIGHTS)
+		bufferLightData(engine.getVertexStreams());
+
+	if (invalidated_domains & INVALIDATE_PALETTE)
+		bufferPalette(getPalettePoints());
+
+	if (invalidated_domains & INVALIDATE_UNIFORMS)
+		updateSettingUniforms();
+
+	// the grid and the volume depend on the lights and on illumination_distance
+	if (invalidated_domains & (INVALIDATE_LIGHTS | INVALIDATE_UNIFORMS))
+		updateDynamicLights();
+
+	// the first update always includes the palette, after which its buffer exists
+	initialized = true;
+	invalidated_domains = 0;
+}
+
+void fractal_generator::generateColors()
+{
+	if (colors_indexed)
 	{
-		if (sm.use_point_sequence)
-			generateFractalFromPointSequenceWithRefresh();
+		color_table.updateColors(engine);
+		return;
+	}
 
-		else generateFractalWithRefresh();
+	// gpu generated points were never on the cpu, and blended keyframes would both need new colors
+	if (gpu_generated || keyframes_valid || !engine.recolorFractal())
+	{
+		generateVertices();
+		return;
 	}
 
+	// the recolored positions are unchanged, so the full upload is only needed when the ring lost the last one
+	if (!vertex_buffers.uploadColors(engine.getVertexStreams()))
+		bufferData(engine.getVertexStreams(), engine.getLineIndices(), engine.getTriangleIndices());
+}
+
+void fractal_generator::generateVertices()
+{
+	// smooth refresh points can be built on the gpu, skipping cpu generation and the vertex upload entirely
+	gpu_generated = sm.gpu_refresh_generation && refresh_generator.isAvailable() && engine.prepareExternalRefreshGeneration();
+
+	if (gpu_generated)
+		generateOnGpu();
+
 	else
 	{
-		if (sm.use_point_sequence)
-			generateFractalFromPointSequence();
+		engine.regenerateFractal();
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+		// only worth reporting when something escaped the arena
+		if (engine.getLastGenerationAllocations() != 0)
+			cout << "generation made " << engine.getLastGenerationAllocations() << " heap allocations" << endl;
+#endif
+
+		bufferData(engine.getVertexStreams(), engine.getLineIndices(), engine.getTriangleIndices());
+	}
+
+	updateGenerationState();
+}
+
+void fractal_generator::beginNextFrame()
+{
+	// gpu generation has to stay on this thread, and costs the cpu little anyway
+	bool gpu_refresh = sm.gpu_refresh_generation && refresh_generator.isAvailable() && engine.canGenerateRefreshExternally();
+
+	if (sm.pipelined_generation && !gpu_refresh && !canBlendKeyframes())
+		pipeline.request();
+}
+
+void fractal_generator::finishPendingFrame()
+{
+	if (!pipeline.pop(pipelined_frame))
+		return;
 
-		else generateFractal();
+	// the engine holds the frame's output again, so everything downstream reads it as if it had been generated here
+	engine.swapOutput(pipelined_frame);
+	gpu_generated = false;
+	bufferData(engine.getVertexStreams(), engine.getLineIndices(), engine.getTriangleIndices());
+	updateGenerationState();
+
+	// the frame was generated after any changes marked before it was requested, so its vertices are current
+	invalidated_domains &= ~INVALIDATE_VERTICES;
+	invalidate(INVALIDATE_LIGHTS | INVALIDATE_PALETTE);
+	updateInvalidatedState();
+}
+
+void fractal_generator::updateGenerationState()
+{
+	displayed_interpolation_state = engine.getInterpolationState();
+	display_revision++;
+
+	// a new generation replaces whatever keyframes the ring held, tickKeyframes revalidates its own
+	keyframes_valid = false;
+	context->setUniform1f("keyframe_blend", 0.0f);
+	context->setUniform3fv("centerpoint", 1, engine.getPointStatistics().centroid);
+	context->setUniform3fv("position_center", 1, vertex_buffers.getPositionCenter());
+	context->setUniform3fv("position_extent", 1, vertex_buffers.getPositionExtent());
+
+	// the compute shader still writes colors, but they're resolved from the table all the same
+	colors_indexed = gpu_generated ? engine.canIndexRefreshColors() : engine.getVertexStreams().hasIndexedColors();
+	context->setUniform1i("indexed_colors", colors_indexed ? 1 : 0);
+
+	if (colors_indexed)
+	{
+		color_table.updateGeneration(engine);
+		context->setUniform1i("indexed_window_size", sm.refresh_value);
+		context->setUniform1i("indexed_deduplicated", engine.isDeduplicated() ? 1 : 0);
+		context->setUniform1f("indexed_interpolation_state", displayed_interpolation_state);
+		context->setUniform1f("indexed_base_size", POINT_SCALE_MAX);
 	}
+}
+
+void fractal_generator::updateSettingUniforms()
+{
 
 	context->setUniform1i("invert_colors", sm.inverted ? 1 : 0);
 	context->setUniform1i("lighting_mode", sm.lm);
-	context->setUniform3fv("centerpoint", 1, focal_point);
 	context->setUniform1f("illumination_distance", sm.lm == CAMERA ? sm.illumination_distance * 10.0f : sm.illumination_distance);
 	context->setUniform1f("point_size_modifier", point_size_modifier);
 
 	updateLineColorOverride();
 }
 
+bool fractal_generator::canBlendKeyframes() const
+{
+	// a random refresh_value draws a new window size for every generation, so its keyframes can differ in vertex count
+	return sm.keyframe_animation && sm.keyframe_count >= 2 && sm.smooth_render && !(sm.refresh_enabled && sm.refresh_value == -1);
+}
+
+void fractal_generator::tickKeyframes()
+{
+	bool swapped = engine.tickInterpolation();
+	float state = engine.getInterpolationState();
+	invalidate(INVALIDATE_PALETTE);
+
+	// keyframes generated before a change to the vertices no longer match it
+	if (invalidated_domains & INVALIDATE_VERTICES)
+		keyframes_valid = false;
+
+	int segment_count = sm.keyframe_count - 1;
+	int segment = glm::clamp(int(state * float(segment_count)), 0, segment_count - 1);
+	float low_state = float(segment) / float(segment_count);
+	float high_state = float(segment + 1) / float(segment_count);
+
+	// the keyframe ahead in the direction of travel is generated last, so when the next segment is reached the
+	// keyframe it shares with this one is already in the current region and only one new keyframe is needed
+	float near_state = sm.reverse ? high_state : low_state;
+	float far_state = sm.reverse ? low_state : high_state;
+
+	bool reusable = keyframes_valid && !swapped;
+	bool bracketed = reusable && ((previous_keyframe_state == near_state && current_keyframe_state == far_state)
+		|| (previous_keyframe_state == far_state && current_keyframe_state == near_state));
+
+	if (!bracketed)
+	{
+		if (!(reusable && current_keyframe_state == near_state))
+			generateKeyframe(near_state);
+
+		generateKeyframe(far_state);
+		keyframes_valid = vertex_buffers.pointPreviousAttributes();
+		context->setUniform3fv("keyframe_position_center", 1, vertex_buffers.getPreviousPositionCenter());
+		context->setUniform3fv("keyframe_position_extent", 1, vertex_buffers.getPreviousPositionExtent());
+	}
+
+	if (keyframes_valid)
+		context->setUniform1f("keyframe_blend", (state - current_keyframe_state) / (previous_keyframe_state - current_keyframe_state));
+
+	// without both keyframes in the ring this state is generated exactly instead
+	else generateKeyframe(state);
+
+	displayed_interpolation_state = state;
+	context->setUniform1f("indexed_interpolation_state", state);
+}
+
+void fractal_generator::generateKeyframe(float keyframe_state)
+{
+	float state = sm.interpolation_state;
+	sm.interpolation_state = keyframe_state;
+	invalidate(INVALIDATE_VERTICES);
+	updateInvalidatedState();
+	sm.interpolation_state = state;
+
+	previous_keyframe_state = current_keyframe_state;
+	current_keyframe_state = keyframe_state;
+}
+
 void fractal_generator::updateLightColorOverride()
 {
 	context->setUniform1i("override_light_color_enabled", light_color_override_index != -3);
@@ -1461,7 +1132,7 @@ void fractal_generator::updateLightColorOverride()
 	case -3: break;
 	case -2: light_color = vec4(0.0f, 0.0f, 0.0f, 1.0f); break;
 	case -1: light_color = vec4(1.0f, 1.0f, 1.0f, 1.0f); break;
-	default: light_color = influenceElement<vec4>(colors_back.at(light_color_override_index), colors_front.at(light_color_override_index), sm.interpolation_state); break;
+	default: light_color = engine.getInterpolatedColor(light_color_override_index); break;
 	}
 
 	if (light_color_override_index != -3)
@@ -1478,7 +1149,7 @@ void fractal_generator::updateLineColorOverride()
 	case -3: break;
 	case -2: line_color = vec4(0.0f, 0.0f, 0.0f, 1.0f); break;
 	case -1: line_color = vec4(1.0f, 1.0f, 1.0f, 1.0f); break;
-	default: line_color = influenceElement<vec4>(colors_back.at(line_color_override_index), colors_front.at(line_color_override_index), sm.interpolation_state); break;
+	default: line_color = engine.getInterpolatedColor(line_color_override_index); break;
 	}
 
 	if (line_color_override_index != -3)
@@ -1495,7 +1166,7 @@ void fractal_generator::updateTriangleColorOverride()
 	case -3: break;
 	case -2: triangle_color = vec4(0.0f, 0.0f, 0.0f, 1.0f); break;
 	case -1: triangle_color = vec4(1.0f, 1.0f, 1.0f, 1.0f); break;
-	default: triangle_color = influenceElement<vec4>(colors_back.at(triangle_color_override_index), colors_front.at(triangle_color_override_index), sm.interpolation_state); break;
+	default: triangle_color = engine.getInterpolatedColor(triangle_color_override_index); break;
 	}
 
 	if (triangle_color_override_index != -3)
@@ -1512,7 +1183,7 @@ void fractal_generator::updatePointColorOverride()
 	case -3: break;
 	case -2: point_color = vec4(0.0f, 0.0f, 0.0f, 1.0f); break;
 	case -1: point_color = vec4(1.0f, 1.0f, 1.0f, 1.0f); break;
-	default: point_color = influenceElement<vec4>(colors_back.at(point_color_override_index), colors_front.at(point_color_override_index), sm.interpolation_state); break;
+	default: point_color = engine.getInterpolatedColor(point_color_override_index); break;
 	}
 
 	if (point_color_override_index != -3)
@@ -1521,16 +1192,16 @@ void fractal_generator::updatePointColorOverride()
 
 void fractal_generator::applyBackground(const int &num_samples)
 {
-	background_color = sm.inverted ? vec4(1.0f) - getSampleColor(num_samples, colors_front) : getSampleColor(num_samples, colors_front);
+	background_color = sm.inverted ? vec4(1.0f) - engine.getSampleColor(num_samples, getColorsFront()) : engine.getSampleColor(num_samples, getColorsFront());
 
-	color_man.adjustLightness(background_color, jep::floatRoll(0.0f, 1.0f, 2));
+	engine.getColorManager().adjustLightness(background_color, jep::floatRoll(0.0f, 1.0f, 2));
 	context->setBackgroundColor(background_color);
 }
 
 void fractal_generator::adjustBackgroundBrightness(float adjustment)
 {
-	float current_lightness = color_man.getHSLFromRGBA(background_color).L;
-	color_man.adjustLightness(background_color, current_lightness + adjustment);
+	float current_lightness = engine.getColorManager().getHSLFromRGBA(background_color).L;
+	engine.getColorManager().adjustLightness(background_color, current_lightness + adjustment);
 	context->setBackgroundColor(background_color);
 }
 
@@ -1542,74 +1213,15 @@ void fractal_generator::loadPointSequence(string name, const vector<vec4> &seque
 	loaded_sequences.push_back(pair<string, vector<vec4> >(name, sequence));
 }
 
-void fractal_generator::printContext()
+const vector<float> &fractal_generator::getPalettePoints()
 {
-	cout << "------------------------------------------------" << endl;
-	cout << "base seed: " << base_seed << endl;
-	cout << "generation seed: " << generation_seed << endl;
-	cout << "current generation: " << sm.generation;
-	sm.reverse ? cout << " <-" << endl : cout << " ->" << endl;
-
-	printMatrices();
-
-	cout << "point count: " << vertex_count << endl;
-	sm.refresh_enabled ? cout << "refresh enabled (" << sm.refresh_value << ")" << endl : cout << "refresh disabled" << endl;
-	cout << "focal point: " + glm::to_string(focal_point) << endl;
-	cout << "max x: " << max_x << endl;
-	cout << "max y: " << max_y << endl;
-	cout << "max z: " << max_z << endl;
-
-	cout << "front palette: " + color_man.getPaletteName(sm.palette_front) << endl;
-	if (sm.palette_front == RANDOM_PALETTE)
-		cout << "current front palette: " + color_man.getPaletteName(sm.random_palette_front) << endl;
-
-	cout << "front color set, seed = " + color_man.toRGBAString(seed_color_front) + ":" << endl;
-	color_man.printColorSet(colors_front);
-	cout << "front background index: " << sm.background_front_index << endl;
-	cout << endl;
-
-	cout << "back palette: " + color_man.getPaletteName(sm.palette_back) << endl;
-	if (sm.palette_back == RANDOM_PALETTE)
-		cout << "current back palette: " + color_man.getPaletteName(sm.random_palette_back) << endl;
-
-	cout << "back color set, seed = " + color_man.toRGBAString(seed_color_back) + ":" << endl;
-	color_man.printColorSet(colors_back);
-	cout << "back background index: " << sm.background_back_index << endl;
-	cout << endl;
-
-	cout << "line width: " << sm.line_width << endl;
-	cout << "interpolation state: " << sm.interpolation_state << endl;
-	cout << "current scale: " << sm.fractal_scale << endl;
-	cout << "bias coefficient: " << sm.bias_coefficient << endl;
-	sm.smooth_render ? cout << "smooth rendering enabled" << endl : cout << "smooth rendering disabled" << endl;
-	sm.randomize_lightness ? cout << "lightness randomization enabled" << endl : cout << "lightness randomization disabled" << endl;
-	sm.randomize_alpha ? cout << "alpha randomization enabled (" << sm.alpha_min << ", " << sm.alpha_max << ")" << endl : cout << "alpha randomization disabled" << endl;
-	sm.refresh_enabled ? cout << "refresh mode enabled (" << sm.refresh_value << ")" << endl : cout << "refresh mode disabled" << endl;
-	sm.two_dimensional ? cout << "2D mode enabled" << endl : cout << "2D mode disabled" << endl;
-	sm.scale_matrices ? cout << "scale matrices enabled" << endl : cout << "scale matrices disabled" << endl;
-	if (sm.inverted)
-		cout << "inverted colors" << endl;
-	//cout << "geometry draw type: " << getStringFromGeometryType(sm.geo_type) << endl;
-	cout << "lighting mode: " << getStringFromLightingMode(sm.lm) << endl;
-	cout << "front geometry matrix type: " << getStringFromGeometryType(geo_type_front) << endl;
-	cout << "back geometry matrix type: " << getStringFromGeometryType(geo_type_back) << endl;
-	cout << "matrix geometry coefficient: " << sm.matrix_geometry_coefficient << endl;
-	cout << "matrix geometry map: " << endl;
-	for (const auto &geo_pair : sm.matrix_geometry_weights)
-	{
-		cout << geo_pair.first << ": " << geo_pair.second << endl;
-	}
-
-	cout << "-----------------------------------------------" << endl;
-	cout << sm.toString() << endl;
-	cout << "-----------------------------------------------" << endl;
-}
+	const vector<vec4> &colors_front = getColorsFront();
+	const vector<vec4> &colors_back = getColorsBack();
 
-vector<float> fractal_generator::getPalettePoints()
-{
 	float swatch_height = 2.0f / colors_front.size();
 
-	vector<float> point_data;
+	// refilled in place, its capacity carries over from the last generation
+	palette_points.clear();
 
 	for (int i = 0; i < colors_front.size(); i++)
 	{
@@ -1621,58 +1233,40 @@ vector<float> fractal_generator::getPalettePoints()
 		float bottom_height = 1.0f - ((i * swatch_height) + swatch_height);
 		float swatch_width = 0.05f;
 
-		vector<vec2> front_points;
 		float front_left = 1.0f - (swatch_width * 3.0f);
 		float front_right = front_left + swatch_width;
-		front_points.push_back(vec2(front_left, top_height)); //front top left
-		front_points.push_back(vec2(front_right, top_height)); //front top right
-		front_points.push_back(vec2(front_right, bottom_height)); // front bottom right
+		addPaletteSwatch(front_left, front_right, top_height, bottom_height, current_color_front, palette_points);
 
-		front_points.push_back(vec2(front_right, bottom_height)); // front bottom right
-		front_points.push_back(vec2(front_left, bottom_height)); // front bottom left
-		front_points.push_back(vec2(front_left, top_height)); //front top left
-
-		for (const vec2 point : front_points)
-		{
-			addDataToPalettePoints(point, current_color_front, point_data);
-		}
-
-		vector<vec2> interpolated_points;
 		float interpolated_left = front_right;
 		float interpolated_right = interpolated_left + swatch_width;
-		interpolated_points.push_back(vec2(interpolated_left, top_height)); //interpolated top left
-		interpolated_points.push_back(vec2(interpolated_right, top_height)); //interpolated top right
-		interpolated_points.push_back(vec2(interpolated_right, bottom_height)); // interpolated bottom right
-
-		interpolated_points.push_back(vec2(interpolated_right, bottom_height)); // interpolated bottom right
-		interpolated_points.push_back(vec2(interpolated_left, bottom_height)); // interpolated bottom left
-		interpolated_points.push_back(vec2(interpolated_left, top_height)); //interpolated top left
-
-		for (const vec2 point : interpolated_points)
-		{
-			addDataToPalettePoints(point, current_color_interpolated, point_data);
-		}
+		addPaletteSwatch(interpolated_left, interpolated_right, top_height, bottom_height, current_color_interpolated, palette_points);
 
-		vector<vec2> back_points;
 		float back_left = interpolated_right;
 		float back_right = back_left + swatch_width;
-		back_points.push_back(vec2(back_left, top_height)); //back top left
-		back_points.push_back(vec2(back_right, top_height)); //back top right
-		back_points.push_back(vec2(back_right, bottom_height)); // back bottom right
-
-		back_points.push_back(vec2(back_right, bottom_height)); // back bottom right
-		back_points.push_back(vec2(back_left, bottom_height)); // back bottom left
-		back_points.push_back(vec2(back_left, top_height)); //back top left
-
-		for (const vec2 point : back_points)
-		{
-			addDataToPalettePoints(point, current_color_back, point_data);
-		}
+		addPaletteSwatch(back_left, back_right, top_height, bottom_height, current_color_back, palette_points);
 	}
 
 	// 6 floats per palette vertex -> 4 for color, 2 for positoin
-	palette_vertex_count = point_data.size() / 6;
-	return point_data;
+	palette_vertex_count = palette_points.size() / 6;
+	return palette_points;
+}
+
+void fractal_generator::addPaletteSwatch(float left, float right, float top, float bottom, const vec4 &color, vector<float> &points) const
+{
+	// two triangles, top left -> top right -> bottom right and bottom right -> bottom left -> top left
+	const vec2 corners[6] = {
+		vec2(left, top),
+		vec2(right, top),
+		vec2(right, bottom),
+		vec2(right, bottom),
+		vec2(left, bottom),
+		vec2(left, top)
+	};
+
+	for (const vec2 &corner : corners)
+	{
+		addDataToPalettePoints(corner, color, points);
+	}
 }
 
 void fractal_generator::addDataToPalettePoints(const vec2 &point, const vec4 &color, vector<float> &points) const
@@ -1685,52 +1279,28 @@ void fractal_generator::addDataToPalettePoints(const vec2 &point, const vec4 &co
 	points.push_back(point.y);
 }
 
-void fractal_generator::addPalettePointsAndBufferData(const vector<float> &vertex_data,  const vector<unsigned short> &line_indices_to_buffer, const vector<unsigned short> &triangle_indices_to_buffer)
+void fractal_generator::generateOnGpu()
 {
-	if (initialized)
-	{
-		glDeleteVertexArrays(1, &VAO);
-		glDeleteBuffers(1, &vertices_vbo);
-		glDeleteBuffers(1, &line_indices);
-		glDeleteBuffers(1, &triangle_indices);
-		glDeleteVertexArrays(1, &palette_vao);
-		glDeleteBuffers(1, &palette_vbo);
-	}
-
-	bufferLightData(vertex_data);
-	bufferPalette(getPalettePoints());
-	bufferData(vertex_data, line_indices_to_buffer, triangle_indices_to_buffer);
-
-	initialized = true;
-}
+	refresh_generator.generate(engine, vertex_buffers, sm.inverted);
 
-void fractal_generator::cycleGeometryType()
-{
-	if (sm.point_sequence_index == GEOMETRY_ENUM_COUNT)
-		sm.point_sequence_index = 0;
-
-	else sm.point_sequence_index++;
-
-	sm.use_point_sequence = GEOMETRY_ENUM_COUNT != sm.point_sequence_index;
-
-	if (sm.use_point_sequence)
-	{
-		sm.setPointSequenceGeometry(sm.point_sequence_index, rg);
-	}
-
-	cout << "point sequence index: " << sm.point_sequence_index << endl;
+	// points are sequential, so every line and triangle index pattern is the identity and draws go unindexed
+	vertex_count = vertex_buffers.getVertexCount();
+	sm.enable_triangles = vertex_count >= 3;
+	sm.enable_lines = vertex_count >= 2;
+	line_index_count = vertex_count;
+	triangle_index_count = vertex_count;
 }
 
 void fractal_generator::cycleBackgroundColorIndex()
 {
-	sm.background_front_index + 1 == colors_front.size() ? sm.background_front_index = 0 : sm.background_front_index++;
+	sm.background_front_index + 1 == getColorsFront().size() ? sm.background_front_index = 0 : sm.background_front_index++;
 	sm.background_back_index = sm.background_front_index;
 	updateBackground();
 }
 
 void fractal_generator::cycleLightColorOverride()
 {
-	if (light_color_override_index == colors_front.size() - 1)
+	if (light_color_override_index == getColorsFront().size() - 1)
 		light_color_override_index = -3;
 
 	else light_color_override_index++;
@@ -1742,7 +1312,7 @@ void fractal_generator::cycleLightColorOverride()
 
 void fractal_generator::cycleLineColorOverride()
 {
-	if (line_color_override_index == colors_front.size() - 1)
+	if (line_color_override_index == getColorsFront().size() - 1)
 		line_color_override_index = -3;
 
 	else line_color_override_index++;
@@ -1754,7 +1324,7 @@ void fractal_generator::cycleLineColorOverride()
 
 void fractal_generator::cycleTriangleColorOverride()
 {
-	if (triangle_color_override_index == colors_front.size() - 1)
+	if (triangle_color_override_index == getColorsFront().size() - 1)
 		triangle_color_override_index = -3;
 
 	else triangle_color_override_index++;
@@ -1766,7 +1336,7 @@ void fractal_generator::cycleTriangleColorOverride()
 
 void fractal_generator::cyclePointColorOverride()
 {
-	if (point_color_override_index == colors_front.size() - 1)
+	if (point_color_override_index == getColorsFront().size() - 1)
 		point_color_override_index = -3;
 
 	else point_color_override_index++;
@@ -1778,37 +1348,10 @@ void fractal_generator::cyclePointColorOverride()
 
 void fractal_generator::setBackgroundColorIndex(int index)
 {
-	if (index < colors_front.size())
+	if (index < getColorsFront().size())
 	{
 		sm.background_front_index = index;
 		sm.background_back_index = index;
 		updateBackground();
 	}
 }
-
-string fractal_generator::getStringFromGeometryType(geometry_type gt) const
-{
-	switch (gt)
-	{
-	case CUBOID: return "cuboid";
-	case CUBE: return "cube";
-	case TETRAHEDRON: return "tetrahedron";
-	case OCTAHEDRON: return "octahedron";
-	case DODECAHEDRON: return "dodecahedron";
-	case ICOSAHEDRON: return "icosahedron";
-	//case LOADED_SEQUENCE: return loaded_sequences.at(current_sequence).first;
-	case GEOMETRY_TYPE_SIZE: return "points";
-	default: return "unknown type";
-	}
-}
-
-void fractal_generator::generateLights()
-{
-	light_indices.clear();
-	int light_index_spacing = sm.num_points / sm.num_lights;
-
-	for (int i = 0; i < sm.num_lights; i++)
-	{
-		light_indices.push_back(i * light_index_spacing);
-	}
-}
\ No newline at end of file
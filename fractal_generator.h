@@ -4,10 +4,14 @@
 #define FRACTAL_GENERATOR_H
 
 #include "header.h"
-#include "random_generator.h"
-#include "color_manager.h"
-#include "settings_manager.h"
-#include "geometry_generator.h"
+#include "fractal_engine.h"
+#include "vertex_buffer_ring.h"
+#include "gpu_refresh_generator.h"
+#include "indexed_color_table.h"
+#include "generation_pipeline.h"
+#include "accumulation_buffer.h"
+#include "light_grid.h"
+#include "irradiance_volume.h"
 
 typedef std::pair<GLenum, attribute_index_method> render_style;
 
@@ -17,37 +21,45 @@ typedef std::pair<GLenum, attribute_index_method> render_style;
 #define SEGMENTED_SOLIDS render_style(GL_LINES, TRIANGLES)
 #define WIREFRAME_CONNECTED render_style(GL_LINE_STRIP, TRIANGLES)
 
+// state that can go stale independently, key handlers mark what they change and updateInvalidatedState rebuilds only that
+enum invalidation_domain
+{
+	INVALIDATE_POSITIONS = 1,
+	INVALIDATE_COLORS = 2,
+	INVALIDATE_SIZES = 4,
+	INVALIDATE_PALETTE = 8,
+	INVALIDATE_LIGHTS = 16,
+	INVALIDATE_UNIFORMS = 32
+};
+
+#define INVALIDATE_VERTICES (INVALIDATE_POSITIONS | INVALIDATE_COLORS | INVALIDATE_SIZES)
+#define INVALIDATE_ALL (INVALIDATE_VERTICES | INVALIDATE_PALETTE | INVALIDATE_LIGHTS | INVALIDATE_UNIFORMS)
+
+// uniform block of depth of field view matrices read by the vertex shader, must match DOF_VIEW_COUNT in VertexShader.glsl
+#define DOF_VIEW_BINDING 0
+#define MAX_DOF_PASSES 50
+
+// samples a progressive image stops at, it is only redrawn from what has been accumulated after that
+#define MAX_PROGRESSIVE_SAMPLES 512
+
 class fractal_generator
 {
 public:
 	fractal_generator(
 		const string &randomization_seed,
 		const shared_ptr<jep::ogl_context> &con,
-		int num_points);
+		long long num_points);
 
 	~fractal_generator() { 
-		glDeleteVertexArrays(1, &VAO); 
-		glDeleteBuffers(1, &vertices_vbo); 
-		glDeleteBuffers(1, &line_indices); 
-		glDeleteBuffers(1, &triangle_indices); 
 		glDeleteVertexArrays(1, &palette_vao);
 		glDeleteBuffers(1, &palette_vbo);
+		glDeleteBuffers(1, &dof_view_buffer);
 	}
 
-	string getSeed() const { return base_seed; }
-
-	void setMatrices();
-
-	void generateFractal();
-	void generateFractalFromPointSequence();
-	void generateFractalWithRefresh();
-	void generateFractalFromPointSequenceWithRefresh();
+	string getSeed() const { return engine.getSeed(); }
 
 	void renderFractal(const int &image_width, const int &image_height, const int &matrix_sequence_count);
 
-	//vector<mat4> generateMatrixSequence(const vector<int> &matrix_indices) const;
-	vector<mat4> generateMatrixSequence(const int &sequence_size) const;
-
 	void updateLightColorOverride();
 	void updateLineColorOverride();
 	void updateTriangleColorOverride();
@@ -57,29 +69,37 @@ public:
 	void drawFractal(shared_ptr<ogl_camera_flying> &cam) const;
 	
 	// keeps track of how many indices are called by draw command, set by geometry index pattern generated in geometry_generator.cpp
-	int point_index_count;
-	int line_index_count;
-	int triangle_index_count;
+	long long point_index_count;
+	long long line_index_count;
+	long long triangle_index_count;
 
 	void invertColors();
 	void newColors();
 	void updateBackground();
 	void regenerateFractal();
 
-	vec4 getSampleColor(const int &samples, const vector<vec4> &color_pool) const;
-	float getLineWidth() const { return sm.line_width; }
+	// marks domains stale, lights are added whenever the vertices they are sampled from change
+	void invalidate(unsigned int domains);
 
-	void printMatrices() const;
+	// rebuilds every stale domain once, however many times it was marked since the last update
+	void updateInvalidatedState();
+
+	float getLineWidth() const { return sm.line_width; }
 
 	vec4 getBackgroundColor() const { return background_color; }
 	void adjustBackgroundBrightness(float adjustment);
 
-	void tickAnimation();
-	void swapMatrices();
-	void cycleColorPalette();
+	// exact generates the new state itself even when keyframe_animation would blend it from keyframes
+	void tickAnimation(bool exact = false);
+
+	// starts generating the next animation frame on the worker thread, so it overlaps presenting the current one
+	// the next tickAnimation uploads it instead of generating
+	void beginNextFrame();
+
+	// uploads a frame started by beginNextFrame right away, after which the engine can be used on this thread again
+	void finishPendingFrame();
 	void loadPointSequence(string name, const vector<vec4> &sequence);
-	void printContext();
-	void cycleGeometryType();
+	void printContext() const { engine.printContext(); }
 	void cycleBackgroundColorIndex();
 	void cycleLightColorOverride();
 	void cycleLineColorOverride();
@@ -88,45 +108,63 @@ public:
 	void setBackgroundColorIndex(int index);
 	int getBackgroundColorIndex() const { return sm.background_front_index; }
 
-	vec3 getFocalPoint() const { return focal_point; }
-	float getAverageDelta() const { return average_delta; }
+	const point_statistics &getPointStatistics() const { return engine.getPointStatistics(); }
 
-	signed int getGeneration() const { return sm.generation; }
+	signed int getGeneration() const { return engine.getGeneration(); }
 
-	vector<vec4> getColorsFront() const { return colors_front; }
-	vector<vec4> getColorsBack() const { return colors_back; }
-	float getInterpolationState() const { return sm.interpolation_state; }
+	const vector<vec4> &getColorsFront() const { return engine.getColorsFront(); }
+	const vector<vec4> &getColorsBack() const { return engine.getColorsBack(); }
+	// state of the frame being displayed, the engine may already be ahead of it
+	float getInterpolationState() const { return displayed_interpolation_state; }
 
 	settings_manager getSettings() const { return sm; }
 	void setTwoDimensional(bool b) { sm.two_dimensional = b; }
 	void setCurrentCustomSequence(int sequence_index) { current_sequence = sequence_index; }
-	string getStringFromGeometryType(geometry_type gt) const;
+	string getStringFromGeometryType(geometry_type gt) const { return engine.getStringFromGeometryType(gt); }
+	fractal_engine &getEngine() { return engine; }
+	const fractal_engine &getEngine() const { return engine; }
 	int getMaxPointSize() const { return max_point_size; }
 
 	vector < pair<string, vector<vec4> > > getLoadedSequences() const { return loaded_sequences; }
 
 private:
-	settings_manager sm;
-	string base_seed;
-	string generation_seed;
-	vector<unsigned int> matrix_sequence_front;
-	vector<unsigned int> matrix_sequence_back;
-	vector< pair<string, mat4> > matrices_front;
-	vector< pair<string, mat4> > matrices_back;
-	vector<vec4> colors_front;
-	vector<vec4> colors_back;
+	// everything a progressive image depends on, its samples are discarded as soon as any of it differs from the last frame
+	struct progressive_frame_state
+	{
+		GLint framebuffer = 0;
+		GLint viewport[4] = { 0, 0, 0, 0 };
+		mat4 mvp;
+		vec3 camera_position;
+		vec3 camera_focus;
+		vec4 background;
+		unsigned int display_revision = 0;
+		float interpolation_state = 0.0f;
+		long long vertices_rendered = 0;
+		bool dof_enabled = false;
+		int dof_passes = 0;
+		float dof_aperture = 0.0f;
+		float point_size_modifier = 0.0f;
+		float line_width = 0.0f;
+		float fractal_scale = 0.0f;
+		int line_mode = 0;
+		int triangle_mode = 0;
+		bool show_points = false;
+		bool show_palette = false;
+		bool light_effects_transparency = false;
+		int color_overrides[4];
+
+		bool operator==(const progressive_frame_state &other) const;
+	};
+
+	// all seeded state and point generation lives in the engine, the viewer only buffers and draws its output
+	fractal_engine engine;
+	settings_manager &sm;
+
+	// must follow engine, which it advances on its worker thread
+	generation_pipeline pipeline;
+	generated_frame pipelined_frame;
+	float displayed_interpolation_state = 0.0f;
 	vec4 background_color;
-	vec4 seed_color_front;
-	vec4 seed_color_back;
-	vector<float> sizes_front;
-	vector<float> sizes_back;
-	geometry_type geo_type_front = GEOMETRY_TYPE_SIZE;
-	geometry_type geo_type_back = GEOMETRY_TYPE_SIZE;
-	random_generator rg;
-	color_manager color_man;
-	geometry_generator gm;
-	vec3 focal_point;
-	float average_delta, max_x, max_y, max_z;
 	// -3 = no override, -2 = black, -1 = white, 0 - n for each interpolated matrix_color
 	int light_color_override_index = -3;
 	int line_color_override_index = -3;
@@ -135,6 +173,14 @@ private:
 	bool dof_enabled = false;
 	int dof_passes = 10;
 	float dof_aperture = 0.005;
+
+	// while nothing on screen changes, each frame adds one jittered sample to the image instead of redrawing it
+	bool progressive_enabled = false;
+	mutable progressive_frame_state progressive_state;
+	mutable int progressive_samples = 0;
+
+	// counts invalidations and new generations, so progressive images notice changes that happen off screen
+	unsigned int display_revision = 0;
 	int max_point_size;
 	bool matrix_geometry_uses_solid_geometry = false;
 	float point_size_modifier = 1.0f;
@@ -142,79 +188,93 @@ private:
 	unsigned int current_frame = 0;
 	unsigned int frame_increment = 1;
 	bool reverse_growth = false;
-	int vertices_to_render = 0;
+	long long vertices_to_render = 0;
 	bool show_growth = false;
 	
-	// current gen parameters	
-	vec4 origin = vec4(0.0f, 0.0f, 0.0f, 1.0f);	
 	// vector instead of a map to make cycling easy
 	vector < pair<string, vector<vec4> > > loaded_sequences;
 	int current_sequence = 0;
 	mat4 fractal_scale_matrix;
 
-	vec4 light_positions[LIGHT_COUNT];
-	vec4 light_colors[LIGHT_COUNT];
-	vector<int> light_indices;
+	// at least LIGHT_COUNT, the uniform arrays take the first LIGHT_COUNT and the grid and volume every light
+	vector<vec4> light_positions = vector<vec4>(LIGHT_COUNT, vec4(0.0f));
+	vector<vec4> light_colors = vector<vec4>(LIGHT_COUNT, vec4(0.0f));
 
 	bool initialized = false;
+	unsigned int invalidated_domains = INVALIDATE_ALL;
 
-	const unsigned short vertex_size = 9;
-	int vertex_count;
+	long long vertex_count;
 	int palette_vertex_count;
+	vector<float> palette_points;
 
-	GLuint vertices_vbo;
-	GLuint palette_vbo;
-	GLuint line_indices;
-	GLuint triangle_indices;
+	vertex_buffer_ring vertex_buffers;
+	gpu_refresh_generator refresh_generator;
+
+	// averages the depth of field passes, drawing is const but the targets are resized to whatever framebuffer is bound
+	mutable accumulation_buffer accumulation;
+
+	// one mvp per depth of field pass, indexed by the vertex shader with gl_InstanceID
+	GLuint dof_view_buffer = 0;
+
+	// the last generation was built by refresh_generator, its vertices are in point order and drawn without indices
+	bool gpu_generated = false;
 
-	GLuint VAO;
+	// the last generation's colors and sizes are resolved by the vertex shader from color_table, not read from the ring
+	bool colors_indexed = false;
+	indexed_color_table color_table;
+
+	// dynamic lights binned by position, in place of the light uniform arrays whenever it is available
+	light_grid dynamic_lights;
+
+	// dynamic lights splatted into a 3d texture, in place of the grid while sm.irradiance_volume_lighting is set
+	irradiance_volume light_volume;
+
+	// while keyframes are blended, the ring's current region holds the keyframe at current_keyframe_state and its previous
+	// region the one at previous_keyframe_state. any other generation invalidates them
+	bool keyframes_valid = false;
+	float current_keyframe_state = 0.0f;
+	float previous_keyframe_state = 0.0f;
+	GLuint palette_vbo;
 	GLuint palette_vao;
 
 	shared_ptr<ogl_context> context;
 
-	void addNewPointAndIterate(
-		vec4 &starting_point,
-		vec4 &starting_color,
-		float &starting_size,
-		int matrix_index_front,
-		int matrix_index_back,
-		vector<float> &points);
-
-	void addPointSequenceAndIterate(
-		mat4 &origin_matrix,
-		vec4 &starting_color,
-		float &starting_size,
-		int matrix_index_front,
-		int matrix_index_back,
-		vector<float> &points,
-		vector<unsigned short> &line_indices,
-		vector<unsigned short> &triangle_indices,
-		int &current_sequence_index_lines,
-		int &current_sequence_index_triangles);
-
-	void addNewPoint(
-		const vec4 &point,
-		const vec4 &color,
-		const float &size,
-		vector<float> &points);
-
-	void bufferData(const vector<float> &vertex_data, const vector<unsigned short> &line_indices, const vector<unsigned short> &triangle_indices);
+	void bufferData(const vertex_streams &vertex_data, const vector<unsigned int> &line_indices, const vector<unsigned int> &triangle_indices);
 	void bufferPalette(const vector<float> &vertex_data);
-	void bufferLightData(const vector<float> &vertex_data);
+	void bufferLightData(const vertex_streams &vertex_data);
+	void updateDynamicLights();
 
-	vector< pair<string, mat4> > generateMatrixVector(const int &count, geometry_type &geo_type);
-	vector<vec4> generateColorVector(const vec4 &seed, color_palette palette, const int &count, color_palette &random_selection) const;
-	vector<float> generateSizeVector(const int &count) const;
-	vector<float> getPalettePoints();
+	const vector<float> &getPalettePoints();
+	void addPaletteSwatch(float left, float right, float top, float bottom, const vec4 &color, vector<float> &points) const;
 	void addDataToPalettePoints(const vec2 &point, const vec4 &color, vector<float> &points) const;
-	void addPalettePointsAndBufferData(const vector<float> &vertex_data, const vector<unsigned short> &line_indices, const vector<unsigned short> &triangle_indices);
-
-	void drawVertices() const;
-	void drawLines() const;
-	void drawTriangles() const;
+	void generateVertices();
+	void generateColors();
+	void generateOnGpu();
+	void updateGenerationState();
+	void updateSettingUniforms();
+
+	// keyframes only correspond vertex for vertex when every generation of a transition uses the same matrix sequences
+	bool canBlendKeyframes() const;
+	void tickKeyframes();
+	void generateKeyframe(float keyframe_state);
+
+	// the view from point view_index of view_count on the aperture, shifted by pixel_jitter. views are centered on the
+	// camera's own mvp without depth of field
+	mat4 getApertureView(const shared_ptr<ogl_camera_flying> &camera, const mat4 &camera_mvp, int view_index, int view_count, const vec2 &pixel_jitter) const;
+
+	// reads back the mvp the camera set, along with everything else a progressive image depends on
+	progressive_frame_state getProgressiveState(const shared_ptr<ogl_camera_flying> &camera) const;
+
+	// draws every view into the accumulation buffer with as few instanced draws as its scene target allows, without resolving
+	void accumulateViews(const mat4 *views, int view_count, float weight, bool keep_image) const;
+	void drawProgressive(const shared_ptr<ogl_camera_flying> &camera) const;
+
+	// one pass of every enabled geometry type, in the order they have always been layered
+	void drawGeometry(GLsizei instance_count = 1) const;
+	void drawVertices(GLsizei instance_count) const;
+	void drawLines(GLsizei instance_count) const;
+	void drawTriangles(GLsizei instance_count) const;
 	void drawPalette() const;
-
-	void generateLights();
 };
 
 #endif
\ No newline at end of file
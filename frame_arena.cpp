@@ -0,0 +1,77 @@
+#include "frame_arena.h"
+#include <cstdint>
+#include <algorithm>
+
+frame_arena::~frame_arena()
+{
+	releaseBlocks();
+}
+
+void frame_arena::addBlock(size_t capacity)
+{
+	arena_block block;
+	block.capacity = std::max(capacity, (size_t)FRAME_ARENA_MIN_BLOCK);
+	block.data = new unsigned char[block.capacity];
+
+	blocks.push_back(block);
+	block_used = 0;
+	block_allocation_count++;
+}
+
+void frame_arena::releaseBlocks()
+{
+	for (const arena_block &block : blocks)
+	{
+		delete[] block.data;
+	}
+
+	blocks.clear();
+	block_used = 0;
+}
+
+void *frame_arena::allocate(size_t byte_count, size_t alignment)
+{
+	std::lock_guard<std::mutex> lock(arena_mutex);
+
+	// aligned against the address rather than the offset, new[] only guarantees fundamental alignment
+	if (!blocks.empty())
+	{
+		const arena_block &block = blocks.back();
+		uintptr_t address = (uintptr_t)(block.data + block_used);
+		size_t padding = (alignment - (address % alignment)) % alignment;
+
+		if (block_used + padding + byte_count <= block.capacity)
+		{
+			block_used += padding + byte_count;
+			return block.data + (block_used - byte_count);
+		}
+	}
+
+	// each overflow block at least doubles the last, so a growing generation takes few of them
+	size_t last_capacity = blocks.empty() ? 0 : blocks.back().capacity;
+	addBlock(std::max(last_capacity * 2, byte_count + alignment));
+
+	const arena_block &block = blocks.back();
+	size_t padding = (alignment - ((uintptr_t)block.data % alignment)) % alignment;
+	block_used = padding + byte_count;
+	return block.data + padding;
+}
+
+void frame_arena::reset()
+{
+	std::lock_guard<std::mutex> lock(arena_mutex);
+
+	if (blocks.size() > 1)
+	{
+		size_t total_capacity = 0;
+		for (const arena_block &block : blocks)
+		{
+			total_capacity += block.capacity;
+		}
+
+		releaseBlocks();
+		addBlock(total_capacity);
+	}
+
+	block_used = 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+// smallest block taken from the heap, so the first few temporaries of a generation don't each need their own
+#define FRAME_ARENA_MIN_BLOCK 65536
+
+// bump allocator for temporaries that live no longer than one generation
+// allocations are carved from the end of the current block and never freed individually, reset() rewinds for the next generation.
+// a generation that outgrows the block takes overflow blocks from the heap, and the next reset replaces all of them with a single
+// block large enough for everything, so a steady run of generations stops allocating after the first
+// allocation is locked, temporaries of parallel passes can be allocated from worker threads
+class frame_arena
+{
+public:
+	frame_arena() {};
+	~frame_arena();
+
+	void *allocate(size_t byte_count, size_t alignment);
+
+	// invalidates everything allocated since the last reset
+	void reset();
+
+	// heap blocks taken since construction
+	long long getBlockAllocationCount() const { return block_allocation_count; }
+
+private:
+	frame_arena(const frame_arena &);
+	frame_arena &operator=(const frame_arena &);
+
+	struct arena_block
+	{
+		unsigned char *data;
+		size_t capacity;
+	};
+
+	std::vector<arena_block> blocks;
+	// bytes used in the last block
+	size_t block_used = 0;
+	long long block_allocation_count = 0;
+	std::mutex arena_mutex;
+
+	void addBlock(size_t capacity);
+	void releaseBlocks();
+};
+
+// lets standard containers allocate from a frame_arena, deallocation does nothing until the arena is reset
+template <typename T>
+class arena_allocator
+{
+public:
+	typedef T value_type;
+
+	arena_allocator(frame_arena &arena_to_use) : arena(&arena_to_use) {}
+
+	template <typename U>
+	arena_allocator(const arena_allocator<U> &other) : arena(other.arena) {}
+
+	T *allocate(size_t count) { return (T *)arena->allocate(sizeof(T) * count, alignof(T)); }
+	void deallocate(T *, size_t) {}
+
+	frame_arena *arena;
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T> &a, const arena_allocator<U> &b) { return a.arena == b.arena; }
+
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T> &a, const arena_allocator<U> &b) { return a.arena != b.arena; }
+
+// a vector whose storage lives until the arena's next reset
+template <typename T>
+using frame_vector = std::vector<T, arena_allocator<T> >;
+
+#endif
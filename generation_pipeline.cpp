@@ -0,0 +1,93 @@
+#include "generation_pipeline.h"
+
+generation_pipeline::generation_pipeline(fractal_engine &engine_to_advance, int depth) : engine(engine_to_advance)
+{
+	max_outstanding = max(depth, 1);
+	frame_slots.resize(max_outstanding);
+	worker = std::thread(&generation_pipeline::workerLoop, this);
+}
+
+generation_pipeline::~generation_pipeline()
+{
+	{
+		std::lock_guard<std::mutex> lock(pipeline_mutex);
+		stopping = true;
+	}
+
+	// a frame being generated is finished first, the worker only checks for stopping between frames
+	pipeline_condition.notify_all();
+	worker.join();
+}
+
+bool generation_pipeline::request()
+{
+	{
+		std::lock_guard<std::mutex> lock(pipeline_mutex);
+		if (requested_count + finished_count >= max_outstanding)
+			return false;
+
+		requested_count++;
+	}
+
+	pipeline_condition.notify_all();
+	return true;
+}
+
+bool generation_pipeline::pop(generated_frame &frame)
+{
+	std::unique_lock<std::mutex> lock(pipeline_mutex);
+	if (requested_count == 0 && finished_count == 0)
+		return false;
+
+	pipeline_condition.wait(lock, [this] { return finished_count > 0; });
+
+	frame.swap(frame_slots[first_finished]);
+	first_finished = (first_finished + 1) % max_outstanding;
+	finished_count--;
+	return true;
+}
+
+void generation_pipeline::waitUntilIdle()
+{
+	std::unique_lock<std::mutex> lock(pipeline_mutex);
+	pipeline_condition.wait(lock, [this] { return requested_count == 0; });
+}
+
+int generation_pipeline::getOutstandingCount() const
+{
+	std::lock_guard<std::mutex> lock(pipeline_mutex);
+	return requested_count + finished_count;
+}
+
+void generation_pipeline::workerLoop()
+{
+	while (true)
+	{
+		int slot;
+
+		{
+			std::unique_lock<std::mutex> lock(pipeline_mutex);
+			pipeline_condition.wait(lock, [this] { return stopping || requested_count > 0; });
+
+			if (stopping)
+				return;
+
+			// pops move first_finished and finished_count together, so the slot after the last finished frame stays put
+			slot = (first_finished + finished_count) % max_outstanding;
+		}
+
+		// the engine and the slot are only touched here while a request is outstanding, so they're used without holding the lock
+		// the slot's old buffers are swapped into the engine, which generates into them again once they come back around
+		engine.tickInterpolation();
+		engine.regenerateFractal();
+		engine.swapOutput(frame_slots[slot]);
+
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex);
+			finished_count++;
+			requested_count--;
+		}
+
+		pipeline_condition.notify_all();
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef GENERATION_PIPELINE_H
+#define GENERATION_PIPELINE_H
+
+#include "fractal_engine.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// advances and regenerates an engine on a worker thread, so the next animation frame is built while the current one is drawn
+// finished frames wait in a queue until popped. requested and waiting frames together never exceed depth, which bounds both
+// memory and how far generation can run ahead of the display
+// the engine belongs to the worker while any requested frame is unfinished, other threads must waitUntilIdle before using it
+class generation_pipeline
+{
+public:
+	generation_pipeline(fractal_engine &engine_to_advance, int depth = 1);
+	~generation_pipeline();
+
+	// queues one tickInterpolation and regenerateFractal, returns false if depth frames are already requested or waiting
+	bool request();
+
+	// blocks until the oldest requested frame is finished and swaps it into frame, returns false if no frame was requested
+	// frame's previous contents are kept and generated into again, so passing the same frame every time reuses its buffers
+	bool pop(generated_frame &frame);
+
+	// blocks until every requested frame is finished
+	void waitUntilIdle();
+
+	// frames requested or waiting to be popped
+	int getOutstandingCount() const;
+
+private:
+	generation_pipeline(const generation_pipeline &);
+	generation_pipeline &operator=(const generation_pipeline &);
+
+	fractal_engine &engine;
+	int max_outstanding;
+
+	std::thread worker;
+	mutable std::mutex pipeline_mutex;
+	std::condition_variable pipeline_condition;
+	// a ring of depth frames, finished frames run from first_finished. a slot keeps whatever pop swapped into it, so the
+	// next frame generated there reuses those buffers
+	std::vector<generated_frame> frame_slots;
+	int first_finished = 0;
+	int finished_count = 0;
+	int requested_count = 0;
+	bool stopping = false;
+
+	void workerLoop();
+};
+
+#endif
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "header.h"
+#include "engine_header.h"
 
 #define BASE_LENGTH 2.0f * 0.61803398875f
 #define HYPOTENUSE_LENGTH 2.0f
@@ -0,0 +1,20 @@
+#pragma once
+
+#ifndef GL_HEADER_H
+#define GL_HEADER_H
+
+// GL base header for the buffer and compute modules, which need OpenGL but none of the viewer's windowing, text or Windows
+// headers. the viewer takes its GL declarations from the jep libraries, headless builds define FRACTAL_HEADLESS_GL and link
+// against the system's GL instead
+
+#include "engine_header.h"
+
+#ifdef FRACTAL_HEADLESS_GL
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#else
+#include "ogl_tools.h"
+#endif
+
+#endif
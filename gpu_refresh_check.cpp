@@ -0,0 +1,133 @@
+// headless check of gpu_refresh_generator against the engine's own smooth refresh points
+// creates a surfaceless GL 4.3 context through EGL, which Mesa's llvmpipe provides without a display, generates several
+// animation frames on both paths and compares every vertex. exits with 77 when no such context can be created
+
+#include "gpu_refresh_generator.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// positions are compared relative to their magnitude, colors and sizes absolutely
+#define REFRESH_CHECK_TOLERANCE 0.0001
+#define REFRESH_CHECK_FRAMES 6
+#define REFRESH_CHECK_SKIPPED 77
+
+static bool createHeadlessContext()
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display == nullptr)
+		return false;
+
+	EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_API))
+		return false;
+
+	const EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attributes);
+	return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+template<class T>
+static void readRegion(GLuint buffer, long long first_vertex, long long vertex_count, vector<T> &values)
+{
+	values.resize(vertex_count);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glGetBufferSubData(GL_ARRAY_BUFFER, sizeof(T) * first_vertex, sizeof(T) * vertex_count, values.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+int main(int argc, char *argv[])
+{
+	string shader_path = argc > 1 ? argv[1] : "RefreshComputeShader.glsl";
+	long long point_count = argc > 2 ? std::stoll(argv[2]) : 20000;
+
+	if (!createHeadlessContext())
+	{
+		cout << "no headless GL 4.3 context, skipping" << endl;
+		return REFRESH_CHECK_SKIPPED;
+	}
+
+	gpu_refresh_generator refresh_generator;
+	if (!refresh_generator.initialize(shader_path))
+		return REFRESH_CHECK_SKIPPED;
+
+	fractal_engine engine("refresh check", point_count);
+	settings_manager &sm = engine.getSettings();
+	sm.refresh_enabled = true;
+	sm.smooth_render = true;
+	sm.refresh_value = 5;
+	sm.deduplicate_refresh_points = false;
+	sm.indexed_refresh_colors = false;
+
+	vertex_buffer_ring vertex_buffers;
+	double worst_difference = 0.0;
+
+	for (int frame = 0; frame < REFRESH_CHECK_FRAMES; frame++)
+	{
+		engine.tickInterpolation();
+		if (frame == REFRESH_CHECK_FRAMES / 2)
+			sm.inverted = !sm.inverted;
+
+		if (!engine.prepareExternalRefreshGeneration())
+		{
+			cout << "the engine cannot generate these refresh points externally" << endl;
+			return 1;
+		}
+
+		refresh_generator.generate(engine, vertex_buffers, sm.inverted);
+
+		// the region's first vertex is where the ring pointed the position attribute
+		void *position_offset = nullptr;
+		glBindVertexArray(vertex_buffers.getVAO());
+		glGetVertexAttribPointerv(0, GL_VERTEX_ATTRIB_ARRAY_POINTER, &position_offset);
+		glBindVertexArray(0);
+
+		long long first_vertex = (long long)((size_t)position_offset / sizeof(vec4));
+		long long vertex_count = vertex_buffers.getVertexCount();
+
+		vector<vec4> positions;
+		vector<vec4> colors;
+		vector<float> sizes;
+		readRegion(vertex_buffers.getPositionBuffer(), first_vertex, vertex_count, positions);
+		readRegion(vertex_buffers.getColorBuffer(), first_vertex, vertex_count, colors);
+		readRegion(vertex_buffers.getSizeBuffer(), first_vertex, vertex_count, sizes);
+
+		engine.regenerateFractal();
+		const vertex_streams &expected = engine.getVertexStreams();
+
+		if (expected.size() != vertex_count)
+		{
+			cout << "frame " << frame << ": " << vertex_count << " gpu vertices, " << expected.size() << " cpu vertices" << endl;
+			return 1;
+		}
+
+		double frame_difference = 0.0;
+		for (long long i = 0; i < vertex_count; i++)
+		{
+			for (int n = 0; n < 4; n++)
+			{
+				double expected_position = expected.getPositions()[i][n];
+				frame_difference = max(frame_difference, std::abs(positions[i][n] - expected_position) / max(1.0, std::abs(expected_position)));
+				frame_difference = max(frame_difference, std::abs(double(colors[i][n]) - expected.getColors()[i][n]));
+			}
+
+			frame_difference = max(frame_difference, std::abs(double(sizes[i]) - expected.getSizes()[i]));
+		}
+
+		cout << "frame " << frame << ": " << vertex_count << " vertices, largest difference " << frame_difference << endl;
+		worst_difference = max(worst_difference, frame_difference);
+	}
+
+	if (glGetError() != GL_NO_ERROR || worst_difference > REFRESH_CHECK_TOLERANCE)
+	{
+		cout << "gpu refresh points differ from the engine's" << endl;
+		return 1;
+	}
+
+	return 0;
+}
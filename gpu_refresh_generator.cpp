@@ -0,0 +1,200 @@
+#include "gpu_refresh_generator.h"
+#include <fstream>
+#include <sstream>
+
+// the minimum GL_MAX_COMPUTE_WORK_GROUP_COUNT every implementation supports, larger generations take several dispatches
+#define MAX_REFRESH_DISPATCH_GROUPS 65535
+
+static bool checkShaderLog(GLuint shader)
+{
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled == GL_TRUE)
+		return true;
+
+	GLint log_length = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+	vector<char> log(max(log_length, 1));
+	glGetShaderInfoLog(shader, log.size(), nullptr, &log[0]);
+	cout << "refresh compute shader failed to compile: " << &log[0] << endl;
+	return false;
+}
+
+static bool checkProgramLog(GLuint program)
+{
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == GL_TRUE)
+		return true;
+
+	GLint log_length = 0;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
+	vector<char> log(max(log_length, 1));
+	glGetProgramInfoLog(program, log.size(), nullptr, &log[0]);
+	cout << "refresh compute shader failed to link: " << &log[0] << endl;
+	return false;
+}
+
+gpu_refresh_generator::~gpu_refresh_generator()
+{
+	if (program == 0)
+		return;
+
+	glDeleteProgram(program);
+	glDeleteBuffers(1, &step_buffer);
+	glDeleteBuffers(1, &sequence_front_buffer);
+	glDeleteBuffers(1, &sequence_back_buffer);
+}
+
+bool gpu_refresh_generator::initialize(const string &shader_path)
+{
+	GLint major_version = 0;
+	GLint minor_version = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+	glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+
+	if (major_version < 4 || (major_version == 4 && minor_version < 3))
+	{
+		cout << "compute shaders unavailable, refresh points will be generated on the cpu" << endl;
+		return false;
+	}
+
+	std::ifstream shader_file(shader_path);
+	if (!shader_file.is_open())
+	{
+		cout << "unable to open " << shader_path << ", refresh points will be generated on the cpu" << endl;
+		return false;
+	}
+
+	std::stringstream shader_stream;
+	shader_stream << shader_file.rdbuf();
+	string shader_source = shader_stream.str();
+	const char *source = shader_source.c_str();
+
+	GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shader, 1, &source, nullptr);
+	glCompileShader(shader);
+
+	if (!checkShaderLog(shader))
+	{
+		glDeleteShader(shader);
+		return false;
+	}
+
+	GLuint linked_program = glCreateProgram();
+	glAttachShader(linked_program, shader);
+	glLinkProgram(linked_program);
+	glDeleteShader(shader);
+
+	if (!checkProgramLog(linked_program))
+	{
+		glDeleteProgram(linked_program);
+		return false;
+	}
+
+	program = linked_program;
+	glGenBuffers(1, &step_buffer);
+	glGenBuffers(1, &sequence_front_buffer);
+	glGenBuffers(1, &sequence_back_buffer);
+
+	return true;
+}
+
+void gpu_refresh_generator::uploadSequences(const fractal_engine &engine)
+{
+	const vector<unsigned int> &sequence_front = engine.getMatrixSequenceFront();
+	const vector<unsigned int> &sequence_back = engine.getMatrixSequenceBack();
+
+	// empty storage cannot be bound, so at least one element is always allocated
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sequence_front_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * max(sequence_front.size(), size_t(1)), nullptr, GL_STATIC_DRAW);
+	if (!sequence_front.empty())
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int) * sequence_front.size(), &sequence_front[0]);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sequence_back_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * max(sequence_back.size(), size_t(1)), nullptr, GL_STATIC_DRAW);
+	if (!sequence_back.empty())
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int) * sequence_back.size(), &sequence_back[0]);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	sequences_uploaded = true;
+	uploaded_sequence_version = engine.getMatrixSequenceVersion();
+	uploaded_sequence_size = (long long)min(sequence_front.size(), sequence_back.size());
+}
+
+void gpu_refresh_generator::uploadSteps(const fractal_engine &engine)
+{
+	const vector<fractal_engine::refresh_step> &steps = engine.getRefreshSteps();
+	packed_steps.resize(max(steps.size(), size_t(1)));
+
+	for (size_t i = 0; i < steps.size(); i++)
+	{
+		packed_steps[i].matrix = steps[i].matrix;
+		packed_steps[i].color = steps[i].color;
+		packed_steps[i].size = steps[i].size;
+	}
+
+	// a few dozen steps at most, respecifying the whole table each frame is cheaper than synchronizing a partial update
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, step_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(gpu_refresh_step) * packed_steps.size(), &packed_steps[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void gpu_refresh_generator::generate(const fractal_engine &engine, vertex_buffer_ring &vertex_buffers, bool inverted)
+{
+	long long point_count = engine.getVertexCount();
+	long long first_vertex = vertex_buffers.reserve(point_count);
+
+	if (!sequences_uploaded || uploaded_sequence_version != engine.getMatrixSequenceVersion())
+		uploadSequences(engine);
+
+	if (point_count == 0 || uploaded_sequence_size == 0)
+		return;
+
+	uploadSteps(engine);
+
+	GLint previous_program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+	glUseProgram(program);
+
+	int window_size = engine.getRefreshWindowSize();
+	glUniform1ui(getUniformLocation("point_count"), GLuint(point_count));
+	glUniform1ui(getUniformLocation("first_vertex"), GLuint(first_vertex));
+	glUniform1ui(getUniformLocation("sequence_size"), GLuint(uploaded_sequence_size));
+	glUniform1ui(getUniformLocation("num_back"), GLuint(engine.getRefreshStepBackCount()));
+	glUniform1i(getUniformLocation("window_size"), window_size);
+	vec4 origin = engine.getOrigin();
+	glUniform4fv(getUniformLocation("origin"), 1, &origin[0]);
+
+	vec4 base_color = inverted ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : vec4(1.0f);
+	glUniform4fv(getUniformLocation("base_color"), 1, &base_color[0]);
+	glUniform1f(getUniformLocation("base_size"), POINT_SCALE_MAX);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, step_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sequence_front_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, sequence_back_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, vertex_buffers.getPositionBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, vertex_buffers.getColorBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, vertex_buffers.getSizeBuffer());
+
+	GLint first_point_location = getUniformLocation("first_point");
+	long long points_per_dispatch = (long long)MAX_REFRESH_DISPATCH_GROUPS * REFRESH_COMPUTE_GROUP_SIZE;
+
+	for (long long first_point = 0; first_point < point_count; first_point += points_per_dispatch)
+	{
+		long long dispatch_points = min(points_per_dispatch, point_count - first_point);
+		glUniform1ui(first_point_location, GLuint(first_point));
+		glDispatchCompute(GLuint((dispatch_points + REFRESH_COMPUTE_GROUP_SIZE - 1) / REFRESH_COMPUTE_GROUP_SIZE), 1, 1);
+	}
+
+	// shader storage writes must be visible to the vertex fetches of the draws that follow
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	for (GLuint binding = 0; binding < 6; binding++)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+	}
+
+	glUseProgram(previous_program);
+}
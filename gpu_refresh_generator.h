@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef GPU_REFRESH_GENERATOR_H
+#define GPU_REFRESH_GENERATOR_H
+
+#include "gl_header.h"
+#include "fractal_engine.h"
+#include "vertex_buffer_ring.h"
+
+// work group width of the refresh compute shader, must match its local_size_x
+#define REFRESH_COMPUTE_GROUP_SIZE 256
+
+// std430 layout of the shader's refresh_step, whose 84 bytes are padded to a multiple of the struct's 16 byte alignment
+struct gpu_refresh_step
+{
+	mat4 matrix;
+	vec4 color;
+	float size;
+	float padding[3];
+};
+
+// builds smooth refresh points with a compute shader that writes straight into the vertex buffer ring
+// the matrix sequences are uploaded once per generation and only the interpolated step table is uploaded per frame,
+// so animating interpolation_state never touches per point data on the cpu
+class gpu_refresh_generator
+{
+public:
+	gpu_refresh_generator() {};
+	~gpu_refresh_generator();
+
+	// compiles the compute shader, returns false if the context is older than 4.3 or the shader fails to build
+	bool initialize(const string &shader_path);
+	bool isAvailable() const { return program != 0; }
+
+	// writes every point of a generation prepared with fractal_engine::prepareExternalRefreshGeneration into the ring's next region
+	void generate(const fractal_engine &engine, vertex_buffer_ring &vertex_buffers, bool inverted);
+
+private:
+	gpu_refresh_generator(const gpu_refresh_generator &);
+	gpu_refresh_generator &operator=(const gpu_refresh_generator &);
+
+	GLuint program = 0;
+	GLuint step_buffer = 0;
+	GLuint sequence_front_buffer = 0;
+	GLuint sequence_back_buffer = 0;
+
+	bool sequences_uploaded = false;
+	unsigned int uploaded_sequence_version = 0;
+	long long uploaded_sequence_size = 0;
+	// staging for the per frame step table, kept so uploading it doesn't allocate
+	vector<gpu_refresh_step> packed_steps;
+
+	void uploadSequences(const fractal_engine &engine);
+	void uploadSteps(const fractal_engine &engine);
+	GLint getUniformLocation(const char *name) const { return glGetUniformLocation(program, name); }
+};
+
+#endif
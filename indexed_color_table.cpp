@@ -0,0 +1,94 @@
+#include "indexed_color_table.h"
+
+// empty storage cannot be bound, so at least one element is always allocated
+static void uploadUnsignedBuffer(GLuint buffer, const vector<unsigned int> &values)
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * max(values.size(), size_t(1)), nullptr, GL_STATIC_DRAW);
+	if (!values.empty())
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int) * values.size(), &values[0]);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+indexed_color_table::~indexed_color_table()
+{
+	if (!created)
+		return;
+
+	glDeleteBuffers(1, &entry_buffer);
+	glDeleteBuffers(1, &sequence_front_buffer);
+	glDeleteBuffers(1, &sequence_back_buffer);
+	glDeleteBuffers(1, &window_start_buffer);
+}
+
+bool indexed_color_table::initialize()
+{
+	GLint vertex_storage_blocks = 0;
+	glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertex_storage_blocks);
+
+	if (vertex_storage_blocks < 4)
+	{
+		cout << "vertex shader storage blocks unavailable, refresh point colors will be generated on the cpu" << endl;
+		return false;
+	}
+
+	glGenBuffers(1, &entry_buffer);
+	glGenBuffers(1, &sequence_front_buffer);
+	glGenBuffers(1, &sequence_back_buffer);
+	glGenBuffers(1, &window_start_buffer);
+	created = true;
+
+	return true;
+}
+
+void indexed_color_table::bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEXED_COLOR_ENTRY_BINDING, entry_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEXED_SEQUENCE_FRONT_BINDING, sequence_front_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEXED_SEQUENCE_BACK_BINDING, sequence_back_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEXED_WINDOW_START_BINDING, window_start_buffer);
+}
+
+void indexed_color_table::updateGeneration(const fractal_engine &engine)
+{
+	if (!sequences_uploaded || uploaded_sequence_version != engine.getMatrixSequenceVersion())
+	{
+		uploadUnsignedBuffer(sequence_front_buffer, engine.getMatrixSequenceFront());
+		uploadUnsignedBuffer(sequence_back_buffer, engine.getMatrixSequenceBack());
+		sequences_uploaded = true;
+		uploaded_sequence_version = engine.getMatrixSequenceVersion();
+	}
+
+	// one start per distinct window, a small fraction of the points whenever deduplication applies
+	engine.getVertexWindowStarts(window_starts);
+	uploadUnsignedBuffer(window_start_buffer, window_starts);
+
+	updateColors(engine);
+}
+
+void indexed_color_table::updateColors(const fractal_engine &engine)
+{
+	const vector<vec4> &colors_front = engine.getColorsFront();
+	const vector<vec4> &colors_back = engine.getColorsBack();
+	const vector<float> &sizes_front = engine.getSizesFront();
+	const vector<float> &sizes_back = engine.getSizesBack();
+
+	// entry i holds front matrix i and back matrix i, the sequences index both sides with the same range
+	entries.resize(max(max(colors_front.size(), colors_back.size()), size_t(1)));
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		entries[i].color_front = i < colors_front.size() ? colors_front[i] : vec4(0.0f);
+		entries[i].color_back = i < colors_back.size() ? colors_back[i] : vec4(0.0f);
+		entries[i].size_front = i < sizes_front.size() ? sizes_front[i] : 0.0f;
+		entries[i].size_back = i < sizes_back.size() ? sizes_back[i] : 0.0f;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, entry_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(gpu_indexed_entry) * entries.size(), &entries[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the refresh compute shader unbinds only its own bindings, so these stay bound between updates
+	bind();
+}
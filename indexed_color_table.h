@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef INDEXED_COLOR_TABLE_H
+#define INDEXED_COLOR_TABLE_H
+
+#include "header.h"
+#include "fractal_engine.h"
+
+// shader storage bindings read by the vertex shader, above the ones the refresh compute shader binds while it runs
+#define INDEXED_COLOR_ENTRY_BINDING 6
+#define INDEXED_SEQUENCE_FRONT_BINDING 7
+#define INDEXED_SEQUENCE_BACK_BINDING 8
+#define INDEXED_WINDOW_START_BINDING 9
+
+// std430 layout of the vertex shader's indexed_entry, padded to the struct's 16 byte alignment
+struct gpu_indexed_entry
+{
+	vec4 color_front;
+	vec4 color_back;
+	float size_front;
+	float size_back;
+	float padding[2];
+};
+
+// what the vertex shader reads to resolve indexed colors: the front and back colors and sizes of every matrix, the matrix
+// sequences, and for deduplicated generations the window each vertex starts at
+// colors are a few hundred bytes and are respecified whenever they change, the sequences only when the engine's version changes
+class indexed_color_table
+{
+public:
+	indexed_color_table() {};
+	~indexed_color_table();
+
+	// vertex shaders are only guaranteed shader storage blocks by some implementations, returns false when there are too few
+	bool initialize();
+	bool isAvailable() const { return created; }
+
+	// uploads everything a new generation of engine's may have changed and binds the buffers, only after initialize succeeded
+	void updateGeneration(const fractal_engine &engine);
+
+	// uploads engine's current colors and sizes, enough for a color change that kept the generation
+	void updateColors(const fractal_engine &engine);
+
+private:
+	indexed_color_table(const indexed_color_table &);
+	indexed_color_table &operator=(const indexed_color_table &);
+
+	bool created = false;
+	GLuint entry_buffer = 0;
+	GLuint sequence_front_buffer = 0;
+	GLuint sequence_back_buffer = 0;
+	GLuint window_start_buffer = 0;
+
+	bool sequences_uploaded = false;
+	unsigned int uploaded_sequence_version = 0;
+	vector<unsigned int> window_starts;
+	vector<gpu_indexed_entry> entries;
+
+	void bind() const;
+};
+
+#endif
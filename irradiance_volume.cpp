@@ -0,0 +1,175 @@
+#include "irradiance_volume.h"
+#include <fstream>
+#include <sstream>
+
+#define IRRADIANCE_GROUP_COUNT (IRRADIANCE_VOLUME_SIZE / IRRADIANCE_GROUP_SIZE)
+
+static bool checkShaderLog(GLuint shader)
+{
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled == GL_TRUE)
+		return true;
+
+	GLint log_length = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+	vector<char> log(max(log_length, 1));
+	glGetShaderInfoLog(shader, log.size(), nullptr, &log[0]);
+	cout << "irradiance compute shader failed to compile: " << &log[0] << endl;
+	return false;
+}
+
+static bool checkProgramLog(GLuint program)
+{
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == GL_TRUE)
+		return true;
+
+	GLint log_length = 0;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
+	vector<char> log(max(log_length, 1));
+	glGetProgramInfoLog(program, log.size(), nullptr, &log[0]);
+	cout << "irradiance compute shader failed to link: " << &log[0] << endl;
+	return false;
+}
+
+irradiance_volume::~irradiance_volume()
+{
+	if (program == 0)
+		return;
+
+	glDeleteProgram(program);
+	glDeleteTextures(1, &volume_texture);
+	glDeleteBuffers(1, &entry_buffer);
+}
+
+bool irradiance_volume::initialize(const string &shader_path)
+{
+	GLint major_version = 0;
+	GLint minor_version = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+	glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+
+	if (major_version < 4 || (major_version == 4 && minor_version < 3))
+	{
+		cout << "compute shaders unavailable, dynamic lights will not be splatted into a volume" << endl;
+		return false;
+	}
+
+	std::ifstream shader_file(shader_path);
+	if (!shader_file.is_open())
+	{
+		cout << "unable to open " << shader_path << ", dynamic lights will not be splatted into a volume" << endl;
+		return false;
+	}
+
+	std::stringstream shader_stream;
+	shader_stream << shader_file.rdbuf();
+	string shader_source = shader_stream.str();
+	const char *source = shader_source.c_str();
+
+	GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shader, 1, &source, nullptr);
+	glCompileShader(shader);
+
+	if (!checkShaderLog(shader))
+	{
+		glDeleteShader(shader);
+		return false;
+	}
+
+	GLuint linked_program = glCreateProgram();
+	glAttachShader(linked_program, shader);
+	glLinkProgram(linked_program);
+	glDeleteShader(shader);
+
+	if (!checkProgramLog(linked_program))
+	{
+		glDeleteProgram(linked_program);
+		return false;
+	}
+
+	program = linked_program;
+	glGenBuffers(1, &entry_buffer);
+
+	// half floats keep the 8 bit precision the lighting ends in, at 2mb for the whole volume. outside the volume every
+	// light is out of reach, so the border is black and samples near the edges fade out rather than clamping
+	const GLfloat border_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glGenTextures(1, &volume_texture);
+	glBindTexture(GL_TEXTURE_3D, volume_texture);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA16F, IRRADIANCE_VOLUME_SIZE, IRRADIANCE_VOLUME_SIZE, IRRADIANCE_VOLUME_SIZE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+	glTexParameterfv(GL_TEXTURE_3D, GL_TEXTURE_BORDER_COLOR, border_color);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	return true;
+}
+
+void irradiance_volume::update(const vec4 *positions, const vec4 *colors, int light_count, float illumination_distance, float cutoff)
+{
+	// the same reach light_grid bins by
+	float range = (illumination_distance / sqrt(cutoff)) * 1.01f;
+
+	entries.clear();
+	vec3 reach_min(0.0f);
+	vec3 reach_max(0.0f);
+
+	for (int i = 0; i < light_count; i++)
+	{
+		if (positions[i].w < .001f)
+			continue;
+
+		gpu_light_entry entry;
+		entry.position = positions[i];
+		entry.color = colors[i];
+
+		vec3 light_position(positions[i]);
+		reach_min = entries.empty() ? light_position - vec3(range) : glm::min(reach_min, light_position - vec3(range));
+		reach_max = entries.empty() ? light_position + vec3(range) : glm::max(reach_max, light_position + vec3(range));
+		entries.push_back(entry);
+	}
+
+	volume_min = reach_min;
+	volume_size = glm::max(reach_max - reach_min, vec3(0.0001f));
+	GLuint entry_count = GLuint(entries.size());
+
+	// empty storage cannot be bound, so at least one light is always allocated
+	if (entries.empty())
+		entries.push_back(gpu_light_entry());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, entry_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(gpu_light_entry) * entries.size(), &entries[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	GLint previous_program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+	glUseProgram(program);
+
+	vec3 voxel_size = volume_size / float(IRRADIANCE_VOLUME_SIZE);
+	glUniform1ui(getUniformLocation("light_count"), entry_count);
+	glUniform3fv(getUniformLocation("volume_min"), 1, &volume_min[0]);
+	glUniform3fv(getUniformLocation("voxel_size"), 1, &voxel_size[0]);
+	glUniform1f(getUniformLocation("illumination_distance"), illumination_distance);
+	glUniform1f(getUniformLocation("light_cutoff"), cutoff);
+
+	// binding 0 is free between refresh generations, which unbind it themselves
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, entry_buffer);
+	glBindImageTexture(0, volume_texture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute(IRRADIANCE_GROUP_COUNT, IRRADIANCE_GROUP_COUNT, IRRADIANCE_GROUP_COUNT);
+
+	// image writes must be visible to the vertex shader's texture fetches
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glBindImageTexture(0, 0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	glUseProgram(previous_program);
+
+	glActiveTexture(GL_TEXTURE0 + IRRADIANCE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_3D, volume_texture);
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef IRRADIANCE_VOLUME_H
+#define IRRADIANCE_VOLUME_H
+
+#include "header.h"
+#include "light_grid.h"
+
+// voxels along each axis of the volume
+#define IRRADIANCE_VOLUME_SIZE 64
+
+// work group size along each axis of the irradiance compute shader, must match its local_size
+#define IRRADIANCE_GROUP_SIZE 4
+
+// texture unit the vertex shader samples the volume from, must match VertexShader.glsl
+#define IRRADIANCE_TEXTURE_UNIT 1
+
+// splats dynamic lights into a 3d texture over the space they can reach, so each vertex takes its light from one trilinear
+// fetch however many lights there are. each voxel holds what the vertex shader's max combine of every light gives at its
+// center, rgb with the lights' own colors and a with the attenuation alone, which an override color is scaled by
+// lighting between voxel centers is interpolated, so it is softer than the exact evaluation and small lights can fall
+// between centers entirely
+class irradiance_volume
+{
+public:
+	irradiance_volume() {};
+	~irradiance_volume();
+
+	// compiles the compute shader and allocates the volume, returns false if the context is older than 4.3 or the shader fails
+	bool initialize(const string &shader_path);
+	bool isAvailable() const { return program != 0; }
+
+	// splats every light with a nonzero w and binds the volume to IRRADIANCE_TEXTURE_UNIT, only after initialize succeeded
+	void update(const vec4 *positions, const vec4 *colors, int light_count, float illumination_distance, float cutoff);
+
+	// the space the volume covers, valid after update
+	vec3 getVolumeMin() const { return volume_min; }
+	vec3 getVolumeSize() const { return volume_size; }
+
+private:
+	irradiance_volume(const irradiance_volume &);
+	irradiance_volume &operator=(const irradiance_volume &);
+
+	GLuint program = 0;
+	GLuint volume_texture = 0;
+	GLuint entry_buffer = 0;
+
+	vec3 volume_min = vec3(0.0f);
+	vec3 volume_size = vec3(1.0f);
+
+	vector<gpu_light_entry> entries;
+
+	GLint getUniformLocation(const char *name) const { return glGetUniformLocation(program, name); }
+};
+
+#endif
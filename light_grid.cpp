@@ -0,0 +1,143 @@
+#include "light_grid.h"
+
+#define LIGHT_GRID_CELL_COUNT (LIGHT_GRID_SIZE * LIGHT_GRID_SIZE * LIGHT_GRID_SIZE)
+
+light_grid::~light_grid()
+{
+	if (!created)
+		return;
+
+	glDeleteBuffers(1, &entry_buffer);
+	glDeleteBuffers(1, &cell_buffer);
+}
+
+bool light_grid::initialize()
+{
+	GLint vertex_storage_blocks = 0;
+	glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertex_storage_blocks);
+
+	if (vertex_storage_blocks < 6)
+	{
+		cout << "vertex shader storage blocks unavailable, dynamic lights will be evaluated for every vertex" << endl;
+		return false;
+	}
+
+	glGenBuffers(1, &entry_buffer);
+	glGenBuffers(1, &cell_buffer);
+	created = true;
+
+	return true;
+}
+
+void light_grid::bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_ENTRY_BINDING, entry_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_CELL_BINDING, cell_buffer);
+}
+
+bool light_grid::getCellRange(int axis, const vec3 &position, float range, int &first_cell, int &last_cell) const
+{
+	first_cell = max(int(floor((position[axis] - range - grid_min[axis]) / cell_size[axis])), 0);
+	last_cell = min(int(floor((position[axis] + range - grid_min[axis]) / cell_size[axis])), LIGHT_GRID_SIZE - 1);
+
+	return first_cell <= last_cell;
+}
+
+bool light_grid::cellInRange(int x, int y, int z, const vec3 &position, float range) const
+{
+	vec3 cell_min = grid_min + cell_size * vec3(float(x), float(y), float(z));
+	vec3 cell_max = cell_min + cell_size;
+
+	// distance from the light to the nearest point of the cell
+	vec3 nearest = glm::clamp(position, cell_min, cell_max);
+	vec3 offset = nearest - position;
+
+	return glm::dot(offset, offset) <= range * range;
+}
+
+void light_grid::update(const vec4 *positions, const vec4 *colors, int light_count, float illumination_distance, float cutoff)
+{
+	// a little past the exact reach, so rounding in the cell tests can only add lights the shader then finds dark
+	float range = (illumination_distance / sqrt(cutoff)) * 1.01f;
+
+	entries.clear();
+	vec3 reach_min(0.0f);
+	vec3 reach_max(0.0f);
+
+	for (int i = 0; i < light_count; i++)
+	{
+		// the uniform arrays mark unused lights with w = 0, which the shader always skipped
+		if (positions[i].w < .001f)
+			continue;
+
+		gpu_light_entry entry;
+		entry.position = positions[i];
+		entry.color = colors[i];
+
+		vec3 light_position(positions[i]);
+		reach_min = entries.empty() ? light_position - vec3(range) : glm::min(reach_min, light_position - vec3(range));
+		reach_max = entries.empty() ? light_position + vec3(range) : glm::max(reach_max, light_position + vec3(range));
+		entries.push_back(entry);
+	}
+
+	grid_min = reach_min;
+	cell_size = glm::max((reach_max - reach_min) / float(LIGHT_GRID_SIZE), vec3(0.0001f));
+
+	// counts first, then offsets from their running sum, then the indices
+	cells.assign(LIGHT_GRID_CELL_COUNT * 2, 0);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		if (pass == 1)
+		{
+			unsigned int offset = LIGHT_GRID_CELL_COUNT * 2;
+			for (int cell = 0; cell < LIGHT_GRID_CELL_COUNT; cell++)
+			{
+				cells[cell * 2] = offset;
+				offset += cells[(cell * 2) + 1];
+			}
+
+			cells.resize(offset);
+			cell_fill.assign(LIGHT_GRID_CELL_COUNT, 0);
+		}
+
+		for (unsigned int light = 0; light < entries.size(); light++)
+		{
+			vec3 light_position(entries[light].position);
+			int first[3], last[3];
+
+			if (!getCellRange(0, light_position, range, first[0], last[0]) || !getCellRange(1, light_position, range, first[1], last[1])
+				|| !getCellRange(2, light_position, range, first[2], last[2]))
+				continue;
+
+			for (int z = first[2]; z <= last[2]; z++)
+			{
+				for (int y = first[1]; y <= last[1]; y++)
+				{
+					for (int x = first[0]; x <= last[0]; x++)
+					{
+						if (!cellInRange(x, y, z, light_position, range))
+							continue;
+
+						int cell = x + (LIGHT_GRID_SIZE * (y + (LIGHT_GRID_SIZE * z)));
+						if (pass == 0)
+							cells[(cell * 2) + 1]++;
+
+						else cells[cells[cell * 2] + cell_fill[cell]++] = light;
+					}
+				}
+			}
+		}
+	}
+
+	// empty storage cannot be bound, so at least one light is always allocated
+	if (entries.empty())
+		entries.push_back(gpu_light_entry());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, entry_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(gpu_light_entry) * entries.size(), &entries[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, cell_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * cells.size(), &cells[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	bind();
+}
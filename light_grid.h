@@ -0,0 +1,68 @@
+#pragma once
+
+#ifndef LIGHT_GRID_H
+#define LIGHT_GRID_H
+
+#include "header.h"
+
+// shader storage bindings read by the vertex shader, after indexed_color_table's
+#define LIGHT_ENTRY_BINDING 10
+#define LIGHT_CELL_BINDING 11
+
+// cells along each axis of the grid, must match VertexShader.glsl
+#define LIGHT_GRID_SIZE 16
+
+// the vertex shader's light_cutoff, below which getAttenuationFromPosition returns nothing
+#define LIGHT_CUTOFF 0.3f
+
+// std430 layout of the vertex shader's light_entry
+struct gpu_light_entry
+{
+	vec4 position;
+	vec4 color;
+};
+
+// bins dynamic lights into a coarse grid over the space they can reach, so each vertex only evaluates the lights of its cell
+// a light reaches illumination_distance / sqrt(cutoff), beyond which its attenuation is zero, and vertices outside every
+// light's reach fall outside the grid and evaluate none. the cell buffer starts with an offset and count per cell, and
+// the offsets point at the light indices that follow
+class light_grid
+{
+public:
+	light_grid() {};
+	~light_grid();
+
+	// needs two vertex shader storage blocks beyond indexed_color_table's four, returns false when there are too few
+	bool initialize();
+	bool isAvailable() const { return created; }
+
+	// bins every light with a nonzero w, uploads the lights and the grid and binds both, only after initialize succeeded
+	void update(const vec4 *positions, const vec4 *colors, int light_count, float illumination_distance, float cutoff);
+
+	// where the shader finds a position's cell, valid after update
+	vec3 getGridMin() const { return grid_min; }
+	vec3 getCellSize() const { return cell_size; }
+
+private:
+	light_grid(const light_grid &);
+	light_grid &operator=(const light_grid &);
+
+	bool created = false;
+	GLuint entry_buffer = 0;
+	GLuint cell_buffer = 0;
+
+	vec3 grid_min = vec3(0.0f);
+	vec3 cell_size = vec3(1.0f);
+
+	vector<gpu_light_entry> entries;
+	vector<unsigned int> cells;
+	vector<unsigned int> cell_fill;
+
+	// the cells along axis whose slabs come within range of position, inclusive, and false if none do
+	bool getCellRange(int axis, const vec3 &position, float range, int &first_cell, int &last_cell) const;
+	bool cellInRange(int x, int y, int z, const vec3 &position, float range) const;
+
+	void bind() const;
+};
+
+#endif
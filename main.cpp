@@ -34,7 +34,7 @@ void getSettings(settings_manager &settings)
 	cout << "point count: ";
 	std::getline(std::cin, point_count);
 	cout << endl;
-	settings.num_points = (point_count == "" || point_count == "\n" || std::stoi(point_count) <= 0) ? 10000 : std::stoi(point_count);
+	settings.num_points = (point_count == "" || point_count == "\n" || std::stoll(point_count) <= 0) ? 10000 : std::min(std::stoll(point_count), MAX_POINT_COUNT);
 
 	string window_width_input;
 	cout << "window width: ";
@@ -132,6 +132,7 @@ int main()
 
 			if (recording)
 			{
+				generator->finishPendingFrame();
 				batchRender(*generator, context, BMP, 4, 1, 1, 720, false, camera);
 				current_gif_frame++;
 
@@ -155,7 +156,15 @@ int main()
 
 			if (!paused)
 			{
-				generator->tickAnimation();
+				// recorded frames are never blended from keyframes
+				generator->tickAnimation(recording);
+			}
+
+			// changes made by keys while paused are still rebuilt without advancing the animation, after any frame already begun
+			else
+			{
+				generator->finishPendingFrame();
+				generator->updateInvalidatedState();
 			}
 
 			if (keys->checkPress(GLFW_KEY_5, false))
@@ -165,9 +174,9 @@ int main()
 
 			if (settings.auto_tracking && !paused)
 			{
-				float average_delta = generator->getAverageDelta();
-				camera->setPosition(generator->getFocalPoint() + vec3(average_delta * 6.0f));
-				camera->setFocus(generator->getFocalPoint());
+				const point_statistics &stats = generator->getPointStatistics();
+				camera->setPosition(stats.centroid + vec3(stats.mean_distance * 6.0f));
+				camera->setFocus(stats.centroid);
 			}
 
 			camera->updateCamera();
@@ -232,10 +241,16 @@ int main()
 				errors_found = true;
 			}*/
 
+			// the next frame is generated while this one is presented
+			if (!paused)
+				generator->beginNextFrame();
+
 			context->swapBuffers();
 
 			if (keys->checkPress(GLFW_KEY_X, false)) 
 			{
+				generator->finishPendingFrame();
+
 				if (keys->checkShiftHold())
 				{
 					string x_quadrants_input;
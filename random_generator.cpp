@@ -195,7 +195,7 @@ unsigned int random_generator::getRandomIntInRange(const unsigned int &min, cons
 		throw;
 
 	unsigned int range = max - min;
-	unsigned int span = unsigned int(getRandomFloat() * float(range));
+	unsigned int span = (unsigned int)(getRandomFloat() * float(range));
 	return min + span;
 }
 
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "header.h"
+#include "engine_header.h"
 
 // TODO refactor class, class doesn't merely create matrices anymore
 
@@ -43,6 +43,8 @@ public:
 	bool getBool(const float &odds) const { return getRandomFloat() < odds; }
 
 	void seed(const string &seed_string);
+	// continues from other's position in its sequence, as if every draw made from other had been made here
+	void copyStateFrom(const random_generator &other) { rng = other.rng; }
 
 	vector<mat4> getMatricesFromPointSequence(const vector<vec4> &vertices, int count) const;
 
@@ -95,11 +95,6 @@ void settings_manager::randomize(const random_generator &rg)
 	rg.getRandomFloat();
 	// END OF CALL RESERVATIONS
 
-	GLfloat width_range[2];
-	glGetFloatv(GL_ALIASED_LINE_WIDTH_RANGE, width_range);
-	glLineWidth(GLfloat(line_width) * width_range[1]);
-	glLineWidth(width_range[0]);
-
 	if (rg.getRandomFloat() < 0.8f)
 	{
 		color_palette synced_palette = color_palette((int)rg.getRandomFloatInRange(0, (int)DEFAULT_COLOR_PALETTE));
@@ -116,8 +111,8 @@ void settings_manager::randomize(const random_generator &rg)
 	int random_line_mode = int(rg.getRandomFloat() * 3.0f);	
 	switch (random_line_mode)
 	{
-	case 0: line_mode = GL_LINES; break;
-	case 1: line_mode = GL_LINE_STRIP; break;
+	case 0: line_mode = PRIMITIVE_LINES; break;
+	case 1: line_mode = PRIMITIVE_LINE_STRIP; break;
 	case 2: line_mode = 0; break;
 	default: break;
 	}
@@ -125,9 +120,9 @@ void settings_manager::randomize(const random_generator &rg)
 	int random_triangle_mode = int(rg.getRandomFloat() * 4.0f);
 	switch (random_triangle_mode)
 	{
-	case 0: triangle_mode = GL_TRIANGLES; break;
-	case 1: triangle_mode = GL_TRIANGLE_STRIP; break;
-	case 2: triangle_mode = GL_TRIANGLE_FAN; break;
+	case 0: triangle_mode = PRIMITIVE_TRIANGLES; break;
+	case 1: triangle_mode = PRIMITIVE_TRIANGLE_STRIP; break;
+	case 2: triangle_mode = PRIMITIVE_TRIANGLE_FAN; break;
 	case 3: triangle_mode = 0; break;
 	default: break;
 	}
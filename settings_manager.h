@@ -1,6 +1,6 @@
 #pragma once
 
-#include "header.h"
+#include "engine_header.h"
 #include "random_generator.h"
 #include "color_manager.h"
 #include "geometry_generator.h"
@@ -15,9 +15,9 @@ public:
 
 	int refresh_value = 5;
 #ifdef _DEBUG
-	int num_points = 2000;
+	long long num_points = 2000;
 #else
-	int num_points = 10000;
+	long long num_points = 10000;
 #endif
 
 #ifdef _DEBUG
@@ -68,6 +68,34 @@ public:
 	bool solid_geometry = true;
 	bool no_background = false;
 	bool light_effects_transparency = false;
+	// chaos game chains are split into blocks and generated on every core, results match the serial chain within float tolerance
+	bool parallel_generation = true;
+	// smooth refresh points with identical matrix windows are built and drawn once
+	bool deduplicate_refresh_points = true;
+	// smooth refresh points are built by a compute shader directly into the vertex buffers when the context supports it
+	bool gpu_refresh_generation = true;
+	// previews animation by generating keyframe_count evenly spaced states per transition and blending between them in the
+	// vertex shader. positions between keyframes are approximate, recording always generates every frame exactly
+	bool keyframe_animation = false;
+	int keyframe_count = 5;
+	// with a fixed refresh_value, smooth refresh points are generated without colors or sizes, the vertex shader sums them from the
+	// front and back color tables over each point's window instead. color changes and inversion then only update the tables
+	bool indexed_refresh_colors = true;
+	// vertices are uploaded as 16 bit positions within each generation's bounds, 8 bit colors and half float sizes, 14 bytes
+	// instead of 36. positions are quantized to 1/65535 of the bounds. gpu generated points always use full floats
+	bool compact_vertices = false;
+	// with a fixed refresh_value, smooth refresh points are expanded into polynomials once per matrix swap and only evaluated per frame
+	bool polynomial_refresh_animation = true;
+	// while a frame is drawn and presented, the next animation frame is generated on a worker thread
+	bool pipelined_generation = true;
+	// the slot the next matrix swap brings in is generated on a background thread during the current transition, with the
+	// same draws the swap would make itself. slots are only a few dozen matrices, so this mostly matters for large num_matrices
+	bool prefetch_generations = false;
+	// adds per axis variance to the point statistics, at the cost of a little more work in the second statistics pass
+	bool compute_point_variance = false;
+	// dynamic lights are splatted into a 64^3 volume over their reach whenever they change, and each vertex takes one trilinear
+	// sample of it instead of evaluating lights. cost no longer depends on the light count, but lighting is blurred to the voxels
+	bool irradiance_volume_lighting = false;
 
 	void randomize(const random_generator &mc);
 
@@ -75,8 +103,8 @@ public:
 	color_palette palette_back = RANDOM_PALETTE;
 	color_palette random_palette_front = DEFAULT_COLOR_PALETTE;
 	color_palette random_palette_back = DEFAULT_COLOR_PALETTE;
-	GLenum line_mode = GL_LINES;
-	GLenum triangle_mode = 0;
+	unsigned int line_mode = PRIMITIVE_LINES;
+	unsigned int triangle_mode = 0;
 	vector<vec4> point_sequence;
 	vector<int> line_indices;
 	vector<int> triangle_indices;
@@ -85,7 +113,7 @@ public:
 	std::map<int, unsigned int> matrix_geometry_weights;
 
 	string toString() const;
-	void settings_manager::setWithString(string settings);
+	void setWithString(string settings);
 
 	geometry_generator gm;
 
@@ -0,0 +1,107 @@
+#include "thread_pool.h"
+
+thread_pool::thread_pool(unsigned int thread_count)
+{
+	if (thread_count == 0)
+		thread_count = std::thread::hardware_concurrency();
+
+	// the calling thread always works a range, so one fewer worker is needed
+	for (unsigned int i = 1; i < thread_count; i++)
+	{
+		workers.push_back(std::thread(&thread_pool::workerLoop, this));
+	}
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		stopping = true;
+	}
+
+	queue_condition.notify_all();
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void thread_pool::workerLoop()
+{
+	while (true)
+	{
+		range_job job;
+
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			queue_condition.wait(lock, [this] { return stopping || next_job < jobs.size(); });
+
+			if (stopping && next_job == jobs.size())
+				return;
+
+			job = jobs[next_job++];
+
+			if (next_job == jobs.size())
+			{
+				jobs.clear();
+				next_job = 0;
+			}
+		}
+
+		runJob(job);
+	}
+}
+
+void thread_pool::runJob(const range_job &job)
+{
+	range_batch &batch = *job.batch;
+
+	if (job.begin < job.end)
+		batch.invoke(batch.task, job.begin, job.end);
+
+	std::lock_guard<std::mutex> completion_lock(batch.completion_mutex);
+	if (--batch.ranges_remaining == 0)
+		batch.completion_condition.notify_one();
+}
+
+void thread_pool::runRanges(long long count, long long min_range, range_invoker invoke, const void *task)
+{
+	if (count <= 0)
+		return;
+
+	int range_count = (int)std::min((long long)getThreadCount(), (count + min_range - 1) / std::max(min_range, 1LL));
+
+	if (range_count <= 1)
+	{
+		invoke(task, 0, count);
+		return;
+	}
+
+	long long range_size = (count + range_count - 1) / range_count;
+
+	range_batch batch;
+	batch.invoke = invoke;
+	batch.task = task;
+	batch.ranges_remaining = range_count - 1;
+
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+
+		for (int i = 1; i < range_count; i++)
+		{
+			range_job job;
+			job.batch = &batch;
+			job.begin = i * range_size;
+			job.end = std::min(job.begin + range_size, count);
+			jobs.push_back(job);
+		}
+	}
+
+	queue_condition.notify_all();
+
+	invoke(task, 0, std::min(range_size, count));
+
+	std::unique_lock<std::mutex> completion_lock(batch.completion_mutex);
+	batch.completion_condition.wait(completion_lock, [&batch] { return batch.ranges_remaining == 0; });
+}
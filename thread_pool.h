@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+// fixed set of worker threads shared by the engine's generation passes
+class thread_pool
+{
+public:
+	// thread_count of 0 uses one thread per hardware core
+	thread_pool(unsigned int thread_count = 0);
+	~thread_pool();
+
+	unsigned int getThreadCount() const { return (unsigned int)workers.size() + 1; }
+
+	// splits [0, count) into contiguous ranges of at least min_range items and runs task(begin, end) on each
+	// the calling thread takes a range itself and returns once every range has completed
+	// task is called through a pointer rather than copied into a std::function, so dispatching a pass allocates nothing
+	template <typename range_task>
+	void parallelFor(long long count, const range_task &task, long long min_range = 1024)
+	{
+		runRanges(count, min_range, &invokeRangeTask<range_task>, &task);
+	}
+
+private:
+	thread_pool(const thread_pool &);
+	thread_pool &operator=(const thread_pool &);
+
+	typedef void (*range_invoker)(const void *task, long long begin, long long end);
+
+	// the ranges of one parallelFor still running, kept on its caller's stack
+	struct range_batch
+	{
+		range_invoker invoke;
+		const void *task;
+		int ranges_remaining;
+		std::mutex completion_mutex;
+		std::condition_variable completion_condition;
+	};
+
+	struct range_job
+	{
+		range_batch *batch;
+		long long begin;
+		long long end;
+	};
+
+	std::vector<std::thread> workers;
+	// taken from next_job on, the vector is only cleared once every job was taken so its capacity is reused
+	std::vector<range_job> jobs;
+	size_t next_job = 0;
+	std::mutex queue_mutex;
+	std::condition_variable queue_condition;
+	bool stopping = false;
+
+	template <typename range_task>
+	static void invokeRangeTask(const void *task, long long begin, long long end) { (*(const range_task *)task)(begin, end); }
+
+	void runRanges(long long count, long long min_range, range_invoker invoke, const void *task);
+	static void runJob(const range_job &job);
+	void workerLoop();
+};
+
+#endif
@@ -0,0 +1,491 @@
+#include "vertex_buffer_ring.h"
+#include <cstring>
+#include <gtc/packing.hpp>
+
+// coherent mappings make writes visible to the gpu without explicit flushes
+#define PERSISTENT_MAP_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+static bool hasExtension(const char *name)
+{
+	GLint extension_count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+
+	for (GLint i = 0; i < extension_count; i++)
+	{
+		const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (extension != nullptr && strcmp(extension, name) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+// glBufferStorage is core from 4.4, earlier contexts only have it through the extension
+static bool supportsBufferStorage()
+{
+	GLint major_version = 0;
+	GLint minor_version = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+	glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+
+	return major_version > 4 || (major_version == 4 && minor_version >= 4) || hasExtension("GL_ARB_buffer_storage");
+}
+
+// returns the persistent mapping, or nullptr for storage allocated with glBufferData
+template<class T>
+static T *createBuffer(GLuint &buffer, GLenum target, long long region_capacity, bool persistent)
+{
+	GLsizeiptr byte_count = sizeof(T) * region_capacity * VERTEX_BUFFER_REGIONS;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+
+	if (!persistent)
+	{
+		glBufferData(target, byte_count, nullptr, GL_DYNAMIC_DRAW);
+		return nullptr;
+	}
+
+	glBufferStorage(target, byte_count, nullptr, PERSISTENT_MAP_FLAGS);
+	return (T *)glMapBufferRange(target, 0, byte_count, PERSISTENT_MAP_FLAGS);
+}
+
+vertex_buffer_ring::~vertex_buffer_ring()
+{
+	release();
+}
+
+void vertex_buffer_ring::allocate(long long new_vertex_capacity, long long new_index_byte_capacity, bool compact_layout)
+{
+	release();
+
+	if (!storage_checked)
+	{
+		persistent_mapping = supportsBufferStorage();
+		storage_checked = true;
+
+		if (!persistent_mapping)
+			cout << "buffer storage unavailable, vertex buffers will be updated with glBufferSubData" << endl;
+	}
+
+	// compact positions are four normalized shorts, colors four normalized bytes and sizes a half float
+	allocated_compact = compact_layout;
+	position_stride = compact_layout ? sizeof(short) * 4 : sizeof(vec4);
+	color_stride = compact_layout ? sizeof(unsigned char) * 4 : sizeof(vec4);
+	size_stride = compact_layout ? sizeof(unsigned short) : sizeof(float);
+
+	// zero sized storage cannot be mapped, and index regions stay 4 byte aligned for 32 bit indices
+	vertex_capacity = max(new_vertex_capacity, 1LL);
+	index_byte_capacity = (max(new_index_byte_capacity, 1LL) + 3) & ~3LL;
+
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	mapped_positions = createBuffer<unsigned char>(position_buffer, GL_ARRAY_BUFFER, vertex_capacity * position_stride, persistent_mapping);
+	mapped_colors = createBuffer<unsigned char>(color_buffer, GL_ARRAY_BUFFER, vertex_capacity * color_stride, persistent_mapping);
+	mapped_sizes = createBuffer<unsigned char>(size_buffer, GL_ARRAY_BUFFER, vertex_capacity * size_stride, persistent_mapping);
+
+	// element array binding is VAO state, so the index buffer stays attached to the VAO
+	mapped_indices = createBuffer<unsigned char>(index_buffer, GL_ELEMENT_ARRAY_BUFFER, index_byte_capacity, persistent_mapping);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	for (int i = 0; i < VERTEX_BUFFER_REGIONS; i++)
+	{
+		region_centers[i] = vec3(0.0f);
+		region_extents[i] = vec3(1.0f);
+	}
+
+	current_region = 0;
+	geometry_region = 0;
+	previous_region = -1;
+	allocated = true;
+}
+
+void vertex_buffer_ring::release()
+{
+	if (!allocated)
+		return;
+
+	for (int i = 0; i < VERTEX_BUFFER_REGIONS; i++)
+	{
+		if (region_fences[i] != 0)
+			glDeleteSync(region_fences[i]);
+
+		region_fences[i] = 0;
+	}
+
+	// deleting a mapped buffer unmaps it
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &position_buffer);
+	glDeleteBuffers(1, &color_buffer);
+	glDeleteBuffers(1, &size_buffer);
+	glDeleteBuffers(1, &index_buffer);
+
+	mapped_positions = nullptr;
+	mapped_colors = nullptr;
+	mapped_sizes = nullptr;
+	mapped_indices = nullptr;
+	allocated = false;
+}
+
+void vertex_buffer_ring::waitForRegion(int region)
+{
+	if (region_fences[region] == 0)
+		return;
+
+	GLenum wait_result = GL_TIMEOUT_EXPIRED;
+	while (wait_result == GL_TIMEOUT_EXPIRED)
+	{
+		// one millisecond per wait, flushing so the fence is guaranteed to eventually signal
+		wait_result = glClientWaitSync(region_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+
+	if (wait_result == GL_WAIT_FAILED)
+		cout << "vertex buffer fence wait failed" << endl;
+
+	glDeleteSync(region_fences[region]);
+	region_fences[region] = 0;
+}
+
+void vertex_buffer_ring::fenceRegion(int region)
+{
+	if (region_fences[region] != 0)
+		glDeleteSync(region_fences[region]);
+
+	region_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+unsigned char *vertex_buffer_ring::beginWrite(unsigned char *mapped, vector<unsigned char> &staging, size_t byte_offset, size_t byte_count)
+{
+	if (persistent_mapping)
+		return mapped + byte_offset;
+
+	staging.resize(max(byte_count, size_t(1)));
+	return &staging[0];
+}
+
+void vertex_buffer_ring::commitWrite(GLuint buffer, const vector<unsigned char> &staging, size_t byte_offset, size_t byte_count) const
+{
+	if (persistent_mapping || byte_count == 0)
+		return;
+
+	// the copy target leaves the VAO's element array binding alone
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(byte_offset), GLsizeiptr(byte_count), &staging[0]);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void vertex_buffer_ring::writePositions(const vector<vec4> &positions, size_t first_vertex)
+{
+	size_t byte_offset = position_stride * first_vertex;
+	size_t byte_count = position_stride * positions.size();
+	unsigned char *destination = beginWrite(mapped_positions, position_staging, byte_offset, byte_count);
+
+	if (!allocated_compact)
+	{
+		region_centers[current_region] = vec3(0.0f);
+		region_extents[current_region] = vec3(1.0f);
+
+		if (!positions.empty())
+			memcpy(destination, positions.data(), sizeof(vec4) * positions.size());
+
+		commitWrite(position_buffer, position_staging, byte_offset, byte_count);
+		return;
+	}
+
+	vec3 min_bounds(positions.empty() ? 0.0f : FLT_MAX);
+	vec3 max_bounds(positions.empty() ? 0.0f : -FLT_MAX);
+	for (const vec4 &position : positions)
+	{
+		min_bounds = glm::min(min_bounds, vec3(position));
+		max_bounds = glm::max(max_bounds, vec3(position));
+	}
+
+	vec3 center = (min_bounds + max_bounds) * 0.5f;
+	vec3 extent = (max_bounds - min_bounds) * 0.5f;
+	vec3 inverse_extent;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// a flat axis decodes to its center whatever is stored
+		if (extent[axis] <= 0.0f)
+			extent[axis] = 1.0f;
+
+		inverse_extent[axis] = 32767.0f / extent[axis];
+	}
+
+	region_centers[current_region] = center;
+	region_extents[current_region] = extent;
+
+	// w is always one, every generated position is the product of affine matrices
+	short *packed = (short *)destination;
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float offset = glm::clamp((positions[i][axis] - center[axis]) * inverse_extent[axis], -32767.0f, 32767.0f);
+			packed[(i * 4) + axis] = (short)std::lround(offset);
+		}
+
+		packed[(i * 4) + 3] = 32767;
+	}
+
+	commitWrite(position_buffer, position_staging, byte_offset, byte_count);
+}
+
+void vertex_buffer_ring::writeColors(const vertex_streams &vertex_data, size_t first_vertex)
+{
+	const vector<vec4> &colors = vertex_data.getColors();
+	const vector<float> &sizes = vertex_data.getSizes();
+
+	size_t color_offset = color_stride * first_vertex;
+	size_t color_count = color_stride * colors.size();
+	size_t size_offset = size_stride * first_vertex;
+	size_t size_count = size_stride * sizes.size();
+	unsigned char *color_destination = beginWrite(mapped_colors, color_staging, color_offset, color_count);
+	unsigned char *size_destination = beginWrite(mapped_sizes, size_staging, size_offset, size_count);
+
+	if (!allocated_compact)
+	{
+		if (!colors.empty())
+		{
+			memcpy(color_destination, colors.data(), sizeof(vec4) * colors.size());
+			memcpy(size_destination, sizes.data(), sizeof(float) * sizes.size());
+		}
+	}
+
+	else
+	{
+		unsigned short *packed_sizes = (unsigned short *)size_destination;
+		for (size_t i = 0; i < colors.size(); i++)
+		{
+			for (int channel = 0; channel < 4; channel++)
+			{
+				color_destination[(i * 4) + channel] = (unsigned char)std::lround(glm::clamp(colors[i][channel], 0.0f, 1.0f) * 255.0f);
+			}
+
+			packed_sizes[i] = (unsigned short)glm::packHalf1x16(sizes[i]);
+		}
+	}
+
+	commitWrite(color_buffer, color_staging, color_offset, color_count);
+	commitWrite(size_buffer, size_staging, size_offset, size_count);
+}
+
+void vertex_buffer_ring::writeIndices(const vector<unsigned int> &indices, size_t byte_offset)
+{
+	if (indices.empty())
+		return;
+
+	size_t byte_count = index_size * indices.size();
+	unsigned char *destination = beginWrite(mapped_indices, index_staging, byte_offset, byte_count);
+
+	if (index_type == GL_UNSIGNED_INT)
+		memcpy(destination, indices.data(), sizeof(unsigned int) * indices.size());
+
+	else
+	{
+		unsigned short *packed = (unsigned short *)destination;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			packed[i] = (unsigned short)indices[i];
+		}
+	}
+
+	commitWrite(index_buffer, index_staging, byte_offset, byte_count);
+}
+
+void vertex_buffer_ring::advanceRegion(long long new_vertex_count, long long new_index_byte_count, bool compact_layout)
+{
+	if (!allocated || new_vertex_count > vertex_capacity || new_index_byte_count > index_byte_capacity || compact_layout != allocated_compact)
+	{
+		allocate(max(new_vertex_count, vertex_capacity), max(new_index_byte_count, index_byte_capacity), compact_layout);
+	}
+
+	else
+	{
+		// every draw issued so far may still read the current region, blended draws the previous one as well, and draws
+		// after uploadColors the geometry region, so all of them are fenced before moving on
+		fenceRegion(current_region);
+		if (previous_region >= 0)
+			fenceRegion(previous_region);
+
+		if (geometry_region != current_region && geometry_region != previous_region)
+			fenceRegion(geometry_region);
+
+		// a region written by uploadColors has no positions of its own to blend from
+		previous_region = geometry_region == current_region ? current_region : -1;
+		previous_vertex_count = vertex_count;
+		current_region = (current_region + 1) % VERTEX_BUFFER_REGIONS;
+
+		// with three regions there is always one that is neither the region just left nor the geometry region
+		if (current_region == geometry_region)
+			current_region = (current_region + 1) % VERTEX_BUFFER_REGIONS;
+
+		waitForRegion(current_region);
+	}
+}
+
+void vertex_buffer_ring::pointAttributes(GLuint first_location, size_t first_position, size_t first_color) const
+{
+	glBindVertexArray(VAO);
+
+	// normalized compact attributes reach the shader as floats, positions still need their region's center and extent
+	glBindBuffer(GL_ARRAY_BUFFER, position_buffer);
+	glVertexAttribPointer(first_location, 4, allocated_compact ? GL_SHORT : GL_FLOAT, allocated_compact ? GL_TRUE : GL_FALSE, 0, (void*)(position_stride * first_position));
+
+	glBindBuffer(GL_ARRAY_BUFFER, color_buffer);
+	glVertexAttribPointer(first_location + 1, 4, allocated_compact ? GL_UNSIGNED_BYTE : GL_FLOAT, allocated_compact ? GL_TRUE : GL_FALSE, 0, (void*)(color_stride * first_color));
+
+	glBindBuffer(GL_ARRAY_BUFFER, size_buffer);
+	glVertexAttribPointer(first_location + 2, 1, allocated_compact ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, 0, (void*)(size_stride * first_color));
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+void vertex_buffer_ring::upload(const vertex_streams &vertex_data, const vector<unsigned int> &line_indices, const vector<unsigned int> &triangle_indices)
+{
+	long long new_vertex_count = vertex_data.size();
+
+	// halving index bandwidth is only possible while every vertex is reachable with 16 bits
+	bool packed_indices = new_vertex_count <= 65536;
+	index_type = packed_indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	index_size = packed_indices ? sizeof(unsigned short) : sizeof(unsigned int);
+
+	advanceRegion(new_vertex_count, (long long)(index_size * (line_indices.size() + triangle_indices.size())), compact);
+
+	geometry_region = current_region;
+	vertex_count = new_vertex_count;
+	line_index_count = (long long)line_indices.size();
+	triangle_index_count = (long long)triangle_indices.size();
+
+	size_t first_vertex = getFirstVertex();
+	size_t first_index_byte = size_t(current_region) * size_t(index_byte_capacity);
+
+	writePositions(vertex_data.getPositions(), first_vertex);
+
+	// indexed colors are resolved by the vertex shader, the region's color and size streams are left as they were
+	if (!vertex_data.hasIndexedColors())
+		writeColors(vertex_data, first_vertex);
+
+	writeIndices(line_indices, first_index_byte);
+	writeIndices(triangle_indices, first_index_byte + (index_size * line_index_count));
+
+	pointAttributes();
+}
+
+bool vertex_buffer_ring::uploadColors(const vertex_streams &vertex_data)
+{
+	if (!allocated || vertex_data.size() != vertex_count || vertex_data.hasIndexedColors() || compact != allocated_compact)
+		return false;
+
+	// the index width and counts are left as they were, they describe the geometry region's indices
+	advanceRegion(vertex_count, 0, allocated_compact);
+
+	// the region just left holds different colors for the same positions, so it can't be blended with this one
+	previous_region = -1;
+
+	writeColors(vertex_data, getFirstVertex());
+
+	pointAttributes();
+	return true;
+}
+
+bool vertex_buffer_ring::pointPreviousAttributes() const
+{
+	if (previous_region < 0 || previous_vertex_count != vertex_count)
+		return false;
+
+	// uploads overwrite the oldest of the regions, so the previous region survives the next upload as well
+	size_t first_vertex = getRegionFirstVertex(previous_region);
+	pointAttributes(4, first_vertex, first_vertex);
+	return true;
+}
+
+long long vertex_buffer_ring::reserve(long long new_vertex_count)
+{
+	advanceRegion(new_vertex_count, 0, false);
+
+	geometry_region = current_region;
+	region_centers[current_region] = vec3(0.0f);
+	region_extents[current_region] = vec3(1.0f);
+	vertex_count = new_vertex_count;
+	line_index_count = 0;
+	triangle_index_count = 0;
+
+	pointAttributes();
+	return (long long)getFirstVertex();
+}
+
+void *vertex_buffer_ring::getLineIndexOffset() const
+{
+	return (void*)(size_t(geometry_region) * size_t(index_byte_capacity));
+}
+
+void *vertex_buffer_ring::getTriangleIndexOffset() const
+{
+	return (void*)((size_t(geometry_region) * size_t(index_byte_capacity)) + (index_size * line_index_count));
+}
+
+// chunk_size is the most vertices a single call may take without splitting a primitive
+// overlap is how many vertices consecutive chunks must share to keep strips connected
+static void getDrawChunking(GLenum mode, long long &chunk_size, long long &overlap)
+{
+	overlap = 0;
+
+	switch (mode)
+	{
+	case GL_LINES: chunk_size = MAX_DRAW_CHUNK - (MAX_DRAW_CHUNK % 2); break;
+	case GL_TRIANGLES: chunk_size = MAX_DRAW_CHUNK - (MAX_DRAW_CHUNK % 3); break;
+	case GL_LINE_STRIP: chunk_size = MAX_DRAW_CHUNK; overlap = 1; break;
+	// an even stride keeps the winding of every chunk's first triangle the same as the unsplit strip
+	case GL_TRIANGLE_STRIP: chunk_size = MAX_DRAW_CHUNK - (MAX_DRAW_CHUNK % 2); overlap = 2; break;
+	// loops and fans reference their first vertex from every primitive and cannot be split
+	case GL_LINE_LOOP:
+	case GL_TRIANGLE_FAN: chunk_size = LLONG_MAX; break;
+	default: chunk_size = MAX_DRAW_CHUNK; break;
+	}
+}
+
+void vertex_buffer_ring::drawArrays(GLenum mode, long long count, GLsizei instance_count) const
+{
+	long long chunk_size, overlap;
+	getDrawChunking(mode, chunk_size, overlap);
+
+	for (long long first = 0; first < count; first += chunk_size - overlap)
+	{
+		long long chunk_count = min(chunk_size, count - first);
+		if (first > 0 && chunk_count <= overlap)
+			break;
+
+		glDrawArraysInstanced(mode, GLint(first), GLsizei(chunk_count), instance_count);
+	}
+}
+
+void vertex_buffer_ring::drawElements(GLenum mode, size_t byte_offset, long long count, GLsizei instance_count) const
+{
+	long long chunk_size, overlap;
+	getDrawChunking(mode, chunk_size, overlap);
+
+	for (long long first = 0; first < count; first += chunk_size - overlap)
+	{
+		long long chunk_count = min(chunk_size, count - first);
+		if (first > 0 && chunk_count <= overlap)
+			break;
+
+		glDrawElementsInstanced(mode, GLsizei(chunk_count), index_type, (void*)(byte_offset + (index_size * first)), instance_count);
+	}
+}
+
+void vertex_buffer_ring::drawLineElements(GLenum mode, long long count, GLsizei instance_count) const
+{
+	drawElements(mode, (size_t)getLineIndexOffset(), min(count, line_index_count), instance_count);
+}
+
+void vertex_buffer_ring::drawTriangleElements(GLenum mode, long long count, GLsizei instance_count) const
+{
+	drawElements(mode, (size_t)getTriangleIndexOffset(), min(count, triangle_index_count), instance_count);
+}
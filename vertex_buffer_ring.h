@@ -0,0 +1,155 @@
+#pragma once
+
+#ifndef VERTEX_BUFFER_RING_H
+#define VERTEX_BUFFER_RING_H
+
+#include "gl_header.h"
+#include "vertex_streams.h"
+
+// regions cycled through by consecutive uploads, the gpu can still be drawing from the previous two while the next is written
+#define VERTEX_BUFFER_REGIONS 3
+
+// largest vertex or index count submitted in a single draw call, larger draws are split into primitive aligned chunks
+#define MAX_DRAW_CHUNK 16777216
+
+// persistently mapped vertex and index storage for the fractal
+// buffers are allocated once and only reallocated when a generation outgrows them, every upload is copied into the oldest
+// region after waiting on the fence placed when that region was last replaced
+// positions and indices are drawn from the geometry region, which is the current region except after uploadColors: then
+// the current region only holds new colors and sizes, and the geometry region is kept out of the cycle until replaced
+// without GL 4.4 or ARB_buffer_storage the buffers are allocated with glBufferData instead, and every write is staged in
+// memory and copied into its region with glBufferSubData
+// the compact layout stores positions as normalized 16 bit offsets within each upload's bounds, colors as 8 bit and sizes
+// as half floats, 14 bytes per vertex instead of 36. the vertex shader decodes positions with getPositionCenter/Extent
+class vertex_buffer_ring
+{
+public:
+	vertex_buffer_ring() {};
+	~vertex_buffer_ring();
+
+	// copies the streams and indices into the next region and points the VAO's attributes at it
+	// indices are packed to 16 bits whenever every vertex of the upload is addressable with them
+	void upload(const vertex_streams &vertex_data, const vector<unsigned int> &line_indices, const vector<unsigned int> &triangle_indices);
+
+	// copies only the color and size streams into the next region, positions and indices are still drawn from the geometry region
+	// returns false without uploading anything if vertex_data has indexed colors, not the vertex count of the last upload, or
+	// the layout was changed since
+	bool uploadColors(const vertex_streams &vertex_data);
+
+	// moves to the next region for vertex_count vertices that the gpu will write itself, and points the VAO's attributes at it
+	// returns the region's first vertex within the stream buffers. the region has no indices
+	// the gpu writes full floats, so this reallocates the buffers in the float layout if they were compact
+	long long reserve(long long vertex_count);
+
+	// layout of later uploads, a change reallocates the buffers at the next upload
+	void setCompact(bool enabled) { compact = enabled; }
+	bool isCompact() const { return allocated_compact; }
+
+	// decodes the positions of the geometry region as center + extent * position, zero and one in the float layout
+	vec3 getPositionCenter() const { return region_centers[geometry_region]; }
+	vec3 getPositionExtent() const { return region_extents[geometry_region]; }
+
+	// the same for the region pointPreviousAttributes points at
+	vec3 getPreviousPositionCenter() const { return region_centers[max(previous_region, 0)]; }
+	vec3 getPreviousPositionExtent() const { return region_extents[max(previous_region, 0)]; }
+
+	// points attributes 4 to 6 at the region written before the current one, so the two can be blended in the vertex shader
+	// returns false if that region was lost to a reallocation or uploadColors, or holds a different vertex count
+	bool pointPreviousAttributes() const;
+
+	// valid after the first upload
+	GLuint getVAO() const { return VAO; }
+	GLuint getIndexBuffer() const { return index_buffer; }
+	GLuint getPositionBuffer() const { return position_buffer; }
+	GLuint getColorBuffer() const { return color_buffer; }
+	GLuint getSizeBuffer() const { return size_buffer; }
+
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, whichever the last upload was packed as
+	GLenum getIndexType() const { return index_type; }
+
+	// byte offsets into the index buffer for the current region, for use as glDrawElements' indices argument
+	void *getLineIndexOffset() const;
+	void *getTriangleIndexOffset() const;
+
+	// draw the first count vertices or indices of the current region, the VAO must be bound
+	// every chunk is drawn instance_count times, the vertex shader tells the copies apart by gl_InstanceID
+	void drawArrays(GLenum mode, long long count, GLsizei instance_count = 1) const;
+	void drawLineElements(GLenum mode, long long count, GLsizei instance_count = 1) const;
+	void drawTriangleElements(GLenum mode, long long count, GLsizei instance_count = 1) const;
+
+	long long getVertexCount() const { return vertex_count; }
+	long long getLineIndexCount() const { return line_index_count; }
+	long long getTriangleIndexCount() const { return triangle_index_count; }
+
+private:
+	vertex_buffer_ring(const vertex_buffer_ring &);
+	vertex_buffer_ring &operator=(const vertex_buffer_ring &);
+
+	bool allocated = false;
+	bool compact = false;
+	bool allocated_compact = false;
+	GLuint VAO = 0;
+	GLuint position_buffer = 0;
+	GLuint color_buffer = 0;
+	GLuint size_buffer = 0;
+	GLuint index_buffer = 0;
+
+	unsigned char *mapped_positions = nullptr;
+	unsigned char *mapped_colors = nullptr;
+	unsigned char *mapped_sizes = nullptr;
+	unsigned char *mapped_indices = nullptr;
+
+	// decided at the first allocation, the staging vectors are only used without persistent mapping
+	bool storage_checked = false;
+	bool persistent_mapping = false;
+	vector<unsigned char> position_staging;
+	vector<unsigned char> color_staging;
+	vector<unsigned char> size_staging;
+	vector<unsigned char> index_staging;
+
+	// bytes per vertex of each stream in the allocated layout
+	size_t position_stride = sizeof(vec4);
+	size_t color_stride = sizeof(vec4);
+	size_t size_stride = sizeof(float);
+
+	// capacities are per region, the index capacity is in bytes since the index width can change between uploads
+	long long vertex_capacity = 0;
+	long long index_byte_capacity = 0;
+
+	GLsync region_fences[VERTEX_BUFFER_REGIONS] = {};
+	int current_region = 0;
+	int geometry_region = 0;
+	// -1 until a region has been written since the last allocation
+	int previous_region = -1;
+	long long previous_vertex_count = 0;
+
+	vec3 region_centers[VERTEX_BUFFER_REGIONS];
+	vec3 region_extents[VERTEX_BUFFER_REGIONS];
+
+	GLenum index_type = GL_UNSIGNED_SHORT;
+	size_t index_size = sizeof(unsigned short);
+
+	long long vertex_count = 0;
+	long long line_index_count = 0;
+	long long triangle_index_count = 0;
+
+	void allocate(long long new_vertex_capacity, long long new_index_byte_capacity, bool compact_layout);
+	// grows or changes the layout of the buffers if needed, otherwise fences the current region and waits until the next one is free
+	void advanceRegion(long long new_vertex_count, long long new_index_byte_count, bool compact_layout);
+	void pointAttributes() const { pointAttributes(0, getRegionFirstVertex(geometry_region), getFirstVertex()); }
+	void pointAttributes(GLuint first_location, size_t first_position, size_t first_color) const;
+	size_t getFirstVertex() const { return getRegionFirstVertex(current_region); }
+	size_t getRegionFirstVertex(int region) const { return size_t(region) * size_t(vertex_capacity); }
+	void release();
+	void waitForRegion(int region);
+	void fenceRegion(int region);
+	// where a write of byte_count bytes at byte_offset goes, the mapping itself or the staging that commitWrite copies from
+	unsigned char *beginWrite(unsigned char *mapped, vector<unsigned char> &staging, size_t byte_offset, size_t byte_count);
+	void commitWrite(GLuint buffer, const vector<unsigned char> &staging, size_t byte_offset, size_t byte_count) const;
+	void writePositions(const vector<vec4> &positions, size_t first_vertex);
+	void writeColors(const vertex_streams &vertex_data, size_t first_vertex);
+	void writeIndices(const vector<unsigned int> &indices, size_t byte_offset);
+	void drawElements(GLenum mode, size_t byte_offset, long long count, GLsizei instance_count) const;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#ifndef VERTEX_STREAMS_H
+#define VERTEX_STREAMS_H
+
+#include "engine_header.h"
+
+// generated vertices stored as one array per attribute, each array is uploaded to its own buffer
+// streams are sized once per generation and written by index, so generation loops never reallocate
+// with indexed colors only positions are stored, the renderer resolves colors and sizes from the matrix sequences itself
+class vertex_streams
+{
+public:
+	vertex_streams() {};
+	~vertex_streams() {};
+
+	void resize(long long count, bool indexed = false)
+	{
+		indexed_colors = indexed;
+		positions.resize(count);
+		colors.resize(indexed ? 0 : count);
+		sizes.resize(indexed ? 0 : count);
+	}
+
+	void clear()
+	{
+		indexed_colors = false;
+		positions.clear();
+		colors.clear();
+		sizes.clear();
+	}
+
+	void swap(vertex_streams &other)
+	{
+		std::swap(indexed_colors, other.indexed_colors);
+		positions.swap(other.positions);
+		colors.swap(other.colors);
+		sizes.swap(other.sizes);
+	}
+
+	// color and size are dropped when colors are indexed
+	void setVertex(long long index, const vec4 &position, const vec4 &color, float size)
+	{
+		positions[index] = position;
+
+		if (!indexed_colors)
+		{
+			colors[index] = color;
+			sizes[index] = size;
+		}
+	}
+
+	// replaces color and size only, the position is left as generated
+	void setColor(long long index, const vec4 &color, float size)
+	{
+		colors[index] = color;
+		sizes[index] = size;
+	}
+
+	long long size() const { return (long long)positions.size(); }
+	bool empty() const { return positions.empty(); }
+	bool hasIndexedColors() const { return indexed_colors; }
+
+	const vector<vec4> &getPositions() const { return positions; }
+	const vector<vec4> &getColors() const { return colors; }
+	const vector<float> &getSizes() const { return sizes; }
+
+private:
+	bool indexed_colors = false;
+	vector<vec4> positions;
+	vector<vec4> colors;
+	vector<float> sizes;
+};
+
+#endif